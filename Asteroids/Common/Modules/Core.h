@@ -152,3 +152,5 @@ void HandleEntityDeath( const onyx::ecs::World& world, onyx::ecs::CommandBuffer&
 void DamageEntity( const onyx::ecs::World& world, onyx::ecs::CommandBuffer& cmd, onyx::AssetManager& asset_manager, const DamageParams& params );
 
 }
+
+COMPONENT_PAGE_SIZE( asteroids::Core::Team, 256 );
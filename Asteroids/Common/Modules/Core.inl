@@ -9,12 +9,11 @@ namespace asteroids::Core
 template< typename SystemSet >
 void RegisterGameplaySystems( SystemSet& system_set )
 {
-	system_set.AddSystem( UpdateCamera::System );
-	system_set.AddSystem( UpdateLifetimes::System );
-	system_set.AddSystem( UpdateOffScreenSpawners::System );
-	system_set.AddSystem( UpdateHealthSprites::System );
+	system_set.AddSystem( UpdateCamera::System, "UpdateCamera" );
+	system_set.AddSystem( UpdateLifetimes::System, "UpdateLifetimes" );
+	system_set.AddSystem( UpdateOffScreenSpawners::System, "UpdateOffScreenSpawners" );
+	system_set.AddSystem( UpdateHealthSprites::System, "UpdateHealthSprites" );
 
-	system_set.AddDependency( UpdateCamera::System, UpdateOffScreenSpawners::System );
 	system_set.AddDependency( UpdateCamera::System, onyx::Graphics2D::UpdateParallaxBackgroundLayers::System );
 	system_set.AddDependency( UpdateHealthSprites::System, onyx::Graphics2D::UpdateAnimatedSprites::System );
 }
@@ -22,7 +21,7 @@ void RegisterGameplaySystems( SystemSet& system_set )
 template< typename SystemSet >
 void RegisterEditorSystems( SystemSet& system_set )
 {
-	system_set.AddSystem( UpdateHealthSprites::System );
+	system_set.AddSystem( UpdateHealthSprites::System, "UpdateHealthSprites" );
 
 	system_set.AddDependency( UpdateHealthSprites::System, onyx::Graphics2D::UpdateAnimatedSprites::System );
 }
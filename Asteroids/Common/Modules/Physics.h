@@ -56,10 +56,11 @@ namespace UpdatePhysicsBodies
 {
 using Context = onyx::ecs::Context< const onyx::Tick >;
 
-using Entities = onyx::ecs::Query<
+// bodies are independent of each other, so big worlds are split into chunks of at least 16 spans
+using Entities = onyx::ecs::Chunk< onyx::ecs::SpanQuery<
 	onyx::ecs::Write< PhysicsBody >,
 	onyx::ecs::Write< onyx::Core::Transform2D >
->;
+>, 16 >;
 
 void System( Context ctx, const Entities& entities );
 }
@@ -83,3 +84,5 @@ void System( Context ctx, const Entities& damagers );
 }
 
 }
+
+COMPONENT_PAGE_SIZE( asteroids::Physics::PhysicsBody, 256 );
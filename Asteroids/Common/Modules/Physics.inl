@@ -8,13 +8,9 @@ namespace asteroids::Physics
 template< typename SystemSet >
 void RegisterGameplaySystems( SystemSet& system_set )
 {
-	system_set.AddSystem( UpdatePhysicsBodies::System );
-	system_set.AddSystem( UpdateCollisions::System );
-	system_set.AddSystem( UpdateDamageOnCollision::System );
-
-	system_set.AddDependency( UpdatePhysicsBodies::System, UpdateCollisions::System );
-	system_set.AddDependency( UpdateCollisions::System, UpdateDamageOnCollision::System );
-	system_set.AddDependency( UpdatePhysicsBodies::System, onyx::Core::UpdateTransform2DLocales::System );
+	system_set.AddSystem( UpdatePhysicsBodies::System, "UpdatePhysicsBodies" );
+	system_set.AddSystem( UpdateCollisions::System, "UpdateCollisions" );
+	system_set.AddSystem( UpdateDamageOnCollision::System, "UpdateDamageOnCollision" );
 }
 
 }
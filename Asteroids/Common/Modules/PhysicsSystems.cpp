@@ -50,25 +50,31 @@ void UpdatePhysicsBodies::System( Context ctx, const Entities& entities )
 
 	const onyx::Tick& tick = ctx.Get< const onyx::Tick >();
 
-	for ( auto& entity : entities )
+	for ( auto& span : entities )
 	{
-		auto [id, body, transform] = entity.Break();
+		auto [mask, _ids, bodies, transforms] = span.Break();
 
-		#ifndef NDEBUG
-		WEAK_ASSERT_ONCE( transform.GetLocale() == glm::mat3( 1.f ), "Players should be in world space, and shouldn't have a locale" );
-		#endif
+		for ( u64 remaining = mask; remaining; remaining &= remaining - 1 )
+		{
+			const u32 index = std::countr_zero( remaining );
+			PhysicsBody& body = bodies[ index ];
+			onyx::Core::Transform2D& transform = transforms[ index ];
+
+			#ifndef NDEBUG
+			WEAK_ASSERT_ONCE( !transform.HasLocale(), "Players should be in world space, and shouldn't have a locale" );
+			#endif
 
-		glm::vec2 position = transform.GetLocalPosition();
-		f32 rotation = transform.GetLocalRotation();
+			glm::vec2 position = transform.GetLocalPosition();
+			f32 rotation = transform.GetLocalRotation();
 
-		position += body.linearVelocity * tick.deltaTime;
-		rotation += body.angularVelocity * tick.deltaTime;
+			position += body.linearVelocity * tick.deltaTime;
+			rotation += body.angularVelocity * tick.deltaTime;
 
-		body.linearVelocity *= glm::clamp( 1.0f - body.linearFriction * tick.deltaTime, 0.f, 1.f );
-		body.angularVelocity *= glm::clamp( 1.0f - body.angularFriction * tick.deltaTime, 0.f, 1.f );
+			body.linearVelocity *= glm::clamp( 1.0f - body.linearFriction * tick.deltaTime, 0.f, 1.f );
+			body.angularVelocity *= glm::clamp( 1.0f - body.angularFriction * tick.deltaTime, 0.f, 1.f );
 
-		transform.SetLocalPosition( position );
-		transform.SetLocalRotation( rotation );
+			transform.SetLocalPositionAndRotation( position, rotation );
+		}
 	}
 }
 
@@ -8,7 +8,7 @@ namespace asteroids::Player
 template< typename SystemSet >
 void RegisterGameplaySystems( SystemSet& system_set )
 {
-	system_set.AddSystem( UpdatePlayers::System );
+	system_set.AddSystem( UpdatePlayers::System, "UpdatePlayers" );
 	system_set.AddDependency( UpdatePlayers::System, asteroids::Physics::UpdatePhysicsBodies::System );
 }
 
@@ -14,4 +14,7 @@ void RegisterReflectors()
 	asteroids::Core::RegisterReflectors( onyx::ecs::ComponentReflectorTable::s_singleton );
 	asteroids::Physics::RegisterReflectors( onyx::ecs::ComponentReflectorTable::s_singleton );
 	asteroids::Player::RegisterReflectors( onyx::ecs::ComponentReflectorTable::s_singleton );
+
+	// every component type has its id now, so they're the same from run to run
+	onyx::ecs::ComponentRegistry::Seal();
 }
\ No newline at end of file
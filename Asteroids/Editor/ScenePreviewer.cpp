@@ -19,6 +19,7 @@ ScenePreviewer::ScenePreviewer( onyx::ecs::World& world )
 	, m_renderQuerySet( world )
 	, m_tickSystemSet( m_tickQuerySet )
 	, m_renderSystemSet( m_renderQuerySet )
+	, m_world( world )
 {
 	onyx::Core::Register2DEditorSystems( m_tickSystemSet );
 	onyx::Graphics2D::RegisterEditorSystems( m_tickSystemSet );
@@ -26,6 +27,9 @@ ScenePreviewer::ScenePreviewer( onyx::ecs::World& world )
 
 	onyx::Graphics2D::RegisterGraphicsSystems( m_renderSystemSet );
 
+	m_frameGraph.AddSystemSet( m_tickSystemSet );
+	m_frameGraph.AddSystemSet( m_renderSystemSet );
+
 	m_spriteRenderer = onyx::LowLevel::GetGraphicsContext().CreateSpriteRenderer();
 
 	m_camera.fov = 2.f;
@@ -63,18 +67,21 @@ void ScenePreviewer::Tick( onyx::IFrameContext& frame_context, std::shared_ptr<
 	m_tick.deltaTime = m_clock.GetDeltaTime();
 
 	m_tickQuerySet.Update();
-	m_tickSystemSet.Run( m_tick, m_camera );
+	m_renderQuerySet.Update();
 
 	onyx::SpriteRenderData sprite_render_data;
-	m_camera.aspectRatio = glm::normalize( glm::vec2( render_target->GetSize() ) );
-	sprite_render_data.cameraMatrix = m_camera.GetMatrix();
 
-	m_renderQuerySet.Update();
-	m_renderSystemSet.Run( sprite_render_data );
+	m_tickSystemSet.SetContext( m_tick, m_camera, m_world );
+	m_renderSystemSet.SetContext( sprite_render_data );
+	m_frameGraph.Run();
 
 	render_target->Clear( frame_context, {} );
 
 	onyx::LowLevel::GetWorkerPool().Wait();
+
+	m_camera.aspectRatio = glm::normalize( glm::vec2( render_target->GetSize() ) );
+	sprite_render_data.cameraMatrix = m_camera.GetMatrix();
+
 	m_spriteRenderer->Render( frame_context, render_target, sprite_render_data );
 }
 
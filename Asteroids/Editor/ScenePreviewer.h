@@ -3,6 +3,7 @@
 #include "Onyx/Clock.h"
 
 #include "Onyx/ECS/CommandBuffer.h"
+#include "Onyx/ECS/FrameGraph.h"
 #include "Onyx/ECS/Query.h"
 #include "Onyx/ECS/SystemContexts.h"
 #include "Onyx/ECS/SystemSet.h"
@@ -25,8 +26,11 @@ struct ScenePreviewer : onyx::ecs::SceneEditor::IPreviewer
 
 	onyx::ecs::QuerySet m_tickQuerySet;
 	onyx::ecs::QuerySet m_renderQuerySet;
-	onyx::ecs::SystemSet< onyx::Tick, onyx::Camera2D > m_tickSystemSet;
+	onyx::ecs::SystemSet< onyx::Tick, onyx::Camera2D, const onyx::ecs::World > m_tickSystemSet;
 	onyx::ecs::SystemSet< onyx::SpriteRenderData > m_renderSystemSet;
+	onyx::ecs::FrameGraph m_frameGraph;
+
+	onyx::ecs::World& m_world;
 
 	onyx::Clock m_clock;
 	onyx::Tick m_tick;
@@ -65,6 +65,9 @@ int main( int argc, const char** argv )
 			window_manager.ProcessEvents();
 			input.UpdateButtonStates();
 
+			// hand the results of any tasks that have finished back to whoever asked for them
+			onyx::LowLevel::GetWorkerPool().RunTaskCallbacks();
+
 			if ( onyx::IFrameContext* frame_context = graphics_context.BeginFrame( *editor_window ) )
 			{
 				ImGui::DockSpaceOverViewport();
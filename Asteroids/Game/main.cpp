@@ -6,6 +6,7 @@
 #include "Onyx/Graphics/RenderTarget.h"
 #include "Onyx/LowLevel/LowLevelInterface.h"
 
+#include "Onyx/ECS/FrameGraph.h"
 #include "Onyx/ECS/Scene.h"
 #include "Onyx/ECS/SystemContexts.h"
 #include "Onyx/ECS/SystemSet.h"
@@ -91,6 +92,11 @@ int main( int argc, const char** argv )
 			onyx::Graphics2D::RegisterGraphicsSystems( prerender_set );
 		}
 
+		// lets sprite collection start as soon as the systems that move and animate sprites are done
+		onyx::ecs::FrameGraph frame_graph;
+		frame_graph.AddSystemSet( tick_set );
+		frame_graph.AddSystemSet( prerender_set );
+
 		INFO( "Loading entry point scene" );
 		{
 			ZoneScopedN( "Load entry point scene" );
@@ -132,13 +138,23 @@ int main( int argc, const char** argv )
 
 				input.UpdateButtonStates();
 
+				// hand the results of any tasks that have finished back to whoever asked for them
+				onyx::LowLevel::GetWorkerPool().RunTaskCallbacks();
+
 				clock.Tick();
 				tick_data.frame += 1;
 				tick_data.time = clock.GetTime();
 				tick_data.deltaTime = clock.GetDeltaTime();
 
+				// both query sets are brought up to date before any systems run, they wait for the workers to finish
 				tick_query_set.Update();
-				tick_set.Run( asteroids_asset_manager, camera, cmd, world, rng, tick_data );
+				render_query_set.Update();
+
+				onyx::SpriteRenderData sprite_render_data;
+
+				tick_set.SetContext( asteroids_asset_manager, camera, cmd, world, rng, tick_data );
+				prerender_set.SetContext( camera, sprite_render_data );
+				frame_graph.Run();
 
 				if ( onyx::IFrameContext* frame_context = graphics_context.BeginFrame( *game_window ) )
 				{
@@ -146,25 +162,23 @@ int main( int argc, const char** argv )
 					if ( !render_target || render_target->GetSize() != target_resolution )
 						render_target = STRONG_ASSERT( graphics_context.CreateRenderTarget( target_resolution ), "Failed to create render target" );
 
-					onyx::SpriteRenderData sprite_render_data;
-
-					camera.aspectRatio = glm::normalize( glm::vec2( render_target->GetSize() ) );
-					sprite_render_data.cameraMatrix = camera.GetMatrix();
-
-					render_query_set.Update();
-					prerender_set.Run( camera, sprite_render_data );
-
 					render_target->Clear( *frame_context, {} );
 
-					// wait for the rendering systems to finish
+					// wait for the systems to finish
 					onyx::LowLevel::GetWorkerPool().Wait();
 
+					camera.aspectRatio = glm::normalize( glm::vec2( render_target->GetSize() ) );
+					sprite_render_data.cameraMatrix = camera.GetMatrix();
+
 					sprite_renderer->Render( *frame_context, render_target, sprite_render_data );
 					frame_context->BlitRenderTarget( render_target, {}, frame_context->GetSize() );
 
 					graphics_context.EndFrame( *frame_context );
 				}
 
+				// the systems have to finish before the world changes
+				onyx::LowLevel::GetWorkerPool().Wait();
+
 				world.CleanUpPages();
 				cmd.Execute();
 				
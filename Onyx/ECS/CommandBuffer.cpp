@@ -0,0 +1,177 @@
+#include "CommandBuffer.h"
+
+#include "tracy/Tracy.hpp"
+
+namespace onyx::ecs
+{
+
+void* CommandArena::Allocate( size_t size, size_t alignment )
+{
+	while ( m_currentBlock < m_blocks.size() )
+	{
+		Block& block = m_blocks[ m_currentBlock ];
+
+		const uintptr_t start = uintptr_t( block.data.get() );
+		const uintptr_t address = ( start + m_used + alignment - 1 ) & ~uintptr_t( alignment - 1 );
+
+		if ( address + size <= start + block.size )
+		{
+			m_used = address + size - start;
+			return reinterpret_cast< void* >( address );
+		}
+
+		++m_currentBlock;
+		m_used = 0;
+	}
+
+	// bigger commands than a block get a block to themselves
+	const size_t block_size = std::max( c_blockSize, size + alignment );
+	m_blocks.push_back( { std::make_unique< std::byte[] >( block_size ), block_size } );
+
+	m_currentBlock = m_blocks.size() - 1;
+	m_used = 0;
+
+	return Allocate( size, alignment );
+}
+
+void CommandArena::Reset()
+{
+	m_currentBlock = 0;
+	m_used = 0;
+}
+
+void RemoveEntityCommand::Execute( World& world, std::span< CommandHeader* const > commands )
+{
+	ZoneScoped;
+
+	std::vector< EntityID > entities;
+	std::vector< EntityID > entities_and_children;
+
+	for ( const CommandHeader* header : commands )
+	{
+		const RemoveEntityCommand& command = header->Get< RemoveEntityCommand >();
+		( command.m_andChildren ? entities_and_children : entities ).push_back( command.m_entity );
+	}
+
+	world.RemoveEntities( entities_and_children, true );
+	world.RemoveEntities( entities );
+}
+
+static bool IsOrderedCommand( const CommandHeader& header )
+{
+	return header.type->kind == CommandKind::CopySceneToWorld || header.type->kind == CommandKind::RemoveEntity;
+}
+
+// each run of commands of the same type is executed in one call
+static void ExecuteRuns( World& world, std::span< CommandHeader* const > commands )
+{
+	for ( size_t run_start = 0; run_start < commands.size(); )
+	{
+		const CommandType* const type = commands[ run_start ]->type;
+
+		size_t run_end = run_start + 1;
+		while ( run_end < commands.size() && commands[ run_end ]->type == type )
+			++run_end;
+
+		type->Execute( world, commands.subspan( run_start, run_end - run_start ) );
+		run_start = run_end;
+	}
+}
+
+CommandBuffer::~CommandBuffer()
+{
+	DestroyCommands();
+}
+
+void CommandBuffer::Execute()
+{
+	ZoneScoped;
+
+	// the entities added by commands get the ids they were given when they were recorded
+	m_world.FlushReservedEntityIDs();
+
+	m_mergedCommands.clear();
+	for ( std::unique_ptr< Stream >& stream : m_streams )
+		if ( stream )
+			m_mergedCommands.insert( m_mergedCommands.end(), stream->m_commands.begin(), stream->m_commands.end() );
+
+	// a job only runs on one thread, so its commands are all in one stream and already in order
+	std::stable_sort( m_mergedCommands.begin(), m_mergedCommands.end(), []( const CommandHeader* lhs, const CommandHeader* rhs ) {
+		return IJob::IsOrderedBefore( lhs->orderKey, rhs->orderKey );
+	} );
+
+	// commands are only batched between scene copies and removals, which run in the order they were recorded
+	// a copy can overwrite components and a removal takes a whole subtree with it, so changes recorded after them have to come after them
+	const std::span< CommandHeader* const > commands = m_mergedCommands;
+
+	for ( size_t segment_start = 0; segment_start < commands.size(); )
+	{
+		size_t segment_end = segment_start;
+		while ( segment_end < commands.size() && !IsOrderedCommand( *commands[ segment_end ] ) )
+			++segment_end;
+
+		size_t ordered_end = segment_end;
+		while ( ordered_end < commands.size() && IsOrderedCommand( *commands[ ordered_end ] ) )
+			++ordered_end;
+
+		ExecuteBatched( commands.subspan( segment_start, segment_end - segment_start ) );
+		ExecuteRuns( m_world, commands.subspan( segment_end, ordered_end - segment_end ) );
+
+		segment_start = ordered_end;
+	}
+
+	DestroyCommands();
+
+	for ( std::unique_ptr< Stream >& stream : m_streams )
+	{
+		if ( !stream )
+			continue;
+
+		// the ids left over get handed back, so the next frame can start from the lowest free ones again
+		m_world.ReleaseEntityIDs( std::span( stream->m_reservedIDs ).subspan( stream->m_nextReservedID ) );
+		stream->m_reservedIDs.clear();
+		stream->m_nextReservedID = 0;
+	}
+
+	m_world.FlushReservedEntityIDs();
+	m_world.m_queryManager.UpdateNeedsRerun( m_world );
+}
+
+void CommandBuffer::ExecuteBatched( std::span< CommandHeader* const > commands )
+{
+	if ( commands.empty() )
+		return;
+
+	for ( std::vector< CommandHeader* >& commands_of_kind : m_commandsByKind )
+		commands_of_kind.clear();
+
+	for ( CommandHeader* header : commands )
+		m_commandsByKind[ u32( header->type->kind ) ].push_back( header );
+
+	// changes to different components can't affect each other, so they're grouped by the table they change
+	std::vector< CommandHeader* >& component_commands = m_commandsByKind[ u32( CommandKind::Component ) ];
+	std::stable_sort( component_commands.begin(), component_commands.end(), []( const CommandHeader* lhs, const CommandHeader* rhs ) {
+		return lhs->componentID < rhs->componentID;
+	} );
+
+	ExecuteRuns( m_world, m_commandsByKind[ u32( CommandKind::AddEntity ) ] );
+	ExecuteRuns( m_world, component_commands );
+}
+
+void CommandBuffer::DestroyCommands()
+{
+	for ( std::unique_ptr< Stream >& stream : m_streams )
+	{
+		if ( !stream )
+			continue;
+
+		for ( const CommandHeader* header : stream->m_commands )
+			if ( header->type->Destructor )
+				header->type->Destructor( header->command );
+
+		stream->m_commands.clear();
+		stream->m_arena.Reset();
+	}
+}
+
+}
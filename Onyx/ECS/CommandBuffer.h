@@ -2,83 +2,173 @@
 
 #include "Scene.h"
 #include "World.h"
+#include "Query.h"
+#include "Onyx/Multithreading.h"
 
-#include <deque>
 #include <functional>
 #include <memory>
-#include <mutex>
 #include <tuple>
 #include <set>
+#include <span>
+#include <vector>
+#include <algorithm>
 
 namespace onyx::ecs
 {
 
-struct ICommand
+struct CommandHeader;
+
+// how Execute batches each kind of command, see CommandBuffer
+enum class CommandKind : u8
+{
+	// new entities and component changes are batched by kind, in this order
+	AddEntity,
+	Component,
+
+	// scene copies and removals run in the order they were recorded, nothing is batched across them
+	CopySceneToWorld,
+	RemoveEntity,
+
+	Count,
+};
+
+// what a command header points at to say what it is and how to run it
+struct CommandType
+{
+	CommandKind kind;
+
+	// runs a batch of commands of this type, in order
+	void( *Execute )( World& world, std::span< CommandHeader* const > commands );
+
+	// null for commands that don't need destroying
+	void( *Destructor )( void* command );
+
+	template< typename Command >
+	static const CommandType s_singleton;
+};
+
+template< typename Command >
+const CommandType CommandType::s_singleton {
+	Command::c_kind,
+	&Command::Execute,
+	std::is_trivially_destructible_v< Command > ? nullptr : +[]( void* command ) { static_cast< Command* >( command )->~Command(); },
+};
+
+// sits in front of each command in its stream's arena
+struct CommandHeader
+{
+	const CommandType* type = nullptr;
+	u64 orderKey = 0;
+	void* command = nullptr;
+
+	// component commands are batched by the table they change
+	ComponentID componentID = 0;
+
+	template< typename Command >
+	Command& Get() const { return *static_cast< Command* >( command ); }
+};
+
+// bump allocates out of blocks that are kept from frame to frame, nothing moves until it's reset
+struct CommandArena
 {
-	virtual ~ICommand() = default;
-	virtual void Execute( World& world ) = 0;
+	void* Allocate( size_t size, size_t alignment );
+	void Reset();
+
+private:
+	constexpr static size_t c_blockSize = 64 * 1024;
+
+	struct Block
+	{
+		std::unique_ptr< std::byte[] > data;
+		size_t size = 0;
+	};
+
+	std::vector< Block > m_blocks;
+	size_t m_currentBlock = 0;
+	size_t m_used = 0;
 };
 
 template< typename ... Components >
-struct AddEntityCommand : ICommand
+struct AddEntityCommand
 {
+	constexpr static CommandKind c_kind = CommandKind::AddEntity;
+
 	EntityID m_entity;
 	std::tuple< Components ... > m_components;
 
 	AddEntityCommand( EntityID entity, Components ... components )
 		: m_entity( entity )
-		, m_components( components ... )
+		, m_components( std::move( components ) ... )
 	{}
 
-	void Execute( World& world ) override
+	static void Execute( World& world, std::span< CommandHeader* const > commands )
 	{
-		world.AddComponents( m_entity, std::get< Components >( m_components ) ... );
+		for ( const CommandHeader* header : commands )
+		{
+			AddEntityCommand& command = header->Get< AddEntityCommand >();
+			std::apply( [&]( Components& ... components ) { world.AddComponents( command.m_entity, std::move( components ) ... ); }, command.m_components );
+		}
 	}
 };
 
-struct RemoveEntityCommand : ICommand
+struct RemoveEntityCommand
 {
+	constexpr static CommandKind c_kind = CommandKind::RemoveEntity;
+
 	EntityID m_entity;
 	bool m_andChildren;
 
 	RemoveEntityCommand( EntityID entity, bool and_children = false ) : m_entity( entity ), m_andChildren( and_children ) {}
 
-	void Execute( World& world ) override
-	{
-		world.RemoveEntity( m_entity, m_andChildren );
-	}
+	static void Execute( World& world, std::span< CommandHeader* const > commands );
 };
 
 template< typename Component >
-struct AddComponentCommand : ICommand
+struct AddComponentCommand
 {
+	constexpr static CommandKind c_kind = CommandKind::Component;
+
 	EntityID m_entity;
 	Component m_component;
 
-	AddComponentCommand( EntityID entity, Component component ) : m_entity( entity ), m_component( component ) {}
+	AddComponentCommand( EntityID entity, Component component ) : m_entity( entity ), m_component( std::move( component ) ) {}
 
-	void Execute( World& world ) override
+	static void Execute( World& world, std::span< CommandHeader* const > commands )
 	{
-		world.AddComponent( m_entity, m_component );
+		ComponentTable< Component >& table = world.GetComponentTable< Component >();
+
+		for ( const CommandHeader* header : commands )
+		{
+			AddComponentCommand& command = header->Get< AddComponentCommand >();
+
+			// the entity may have been removed in an earlier frame
+			if ( world.IsAlive( command.m_entity ) )
+				world.OnComponentAdded( command.m_entity, table.AddComponent( command.m_entity, std::move( command.m_component ) ) );
+		}
 	}
 };
 
 template< typename Component >
-struct RemoveComponentCommand : ICommand
+struct RemoveComponentCommand
 {
+	constexpr static CommandKind c_kind = CommandKind::Component;
+
 	EntityID m_entity;
 
 	RemoveComponentCommand( EntityID entity ) : m_entity( entity ) {}
 
-	void Execute( World& world ) override
+	static void Execute( World& world, std::span< CommandHeader* const > commands )
 	{
-		world.RemoveComponent< Component >( m_entity );
+		for ( const CommandHeader* header : commands )
+			world.RemoveComponent< Component >( header->Get< RemoveComponentCommand >().m_entity );
 	}
 };
 
 template< typename Func >
-struct CopySceneToWorldCommand : ICommand
+struct CopySceneToWorldCommand
 {
+	constexpr static CommandKind c_kind = CommandKind::CopySceneToWorld;
+
 	std::shared_ptr< Scene > m_scene;
 	Func m_func;
 
@@ -89,7 +179,13 @@ struct CopySceneToWorldCommand : ICommand
 		WEAK_ASSERT( m_scene->GetLoadingState() != LoadingState::Errored );
 	}
 
-	void Execute( World& world ) override
+	static void Execute( World& world, std::span< CommandHeader* const > commands )
+	{
+		for ( const CommandHeader* header : commands )
+			header->Get< CopySceneToWorldCommand >().Execute( world );
+	}
+
+	void Execute( World& world )
 	{
 		ZoneScoped;
 
@@ -98,7 +194,7 @@ struct CopySceneToWorldCommand : ICommand
 
 		if ( !WEAK_ASSERT( m_scene->GetLoadingState() == LoadingState::Loaded ) )
 			return;
-		
+
 		IDMap entity_id_map;
 		m_scene->CopyToWorld( world, entity_id_map );
 
@@ -107,43 +203,53 @@ struct CopySceneToWorldCommand : ICommand
 	}
 };
 
+// commands can be recorded from any number of jobs at once without them waiting on each other
+// each thread records into its own stream, and Execute puts the streams back together in an order that doesn't depend on
+// which threads ran which jobs, jobs in the order they were added to their graph, and each job's commands in the order it recorded them
+// jobs split up with RunAndWait come after the job that split them, in the order they were passed in
+// graphs and RunAndWaits from outside of a job are kept in the order they were started, with the commands recorded outside of any job between them
+// threads that aren't workers share a stream, so only one of them should record at a time, and nothing should record during Execute
+// commands live in per-stream arenas until Execute, so the reference AddComponent returns can be changed until then
+// Execute applies the commands in batches, between each scene copy or removal and the next
+// each batch adds its new entities first, then makes its component changes one component type at a time, keeping the order above
+// runs of scene copies or removals are batched too, but never moved past any other command
 struct CommandBuffer
 {
-	CommandBuffer( World& world ) : m_world( world ) {}
+	CommandBuffer( World& world )
+		: m_world( world )
+		, m_streams( onyx::LowLevel::GetWorkerPool().GetWorkerCount() + 1 )
+	{}
+
+	~CommandBuffer();
 
 	template< typename ... Components >
 	EntityID AddEntity( Components ... components )
 	{
-		std::scoped_lock lock( m_mutex );
+		Stream& stream = GetStream();
 
-		EntityID entity_id = m_world.AddEntity();
+		// the id is reserved now, and the entity gets its components when the command runs
+		const EntityID entity_id = stream.TakeEntityID( m_world );
 
-		m_commands.push_back( std::make_unique< AddEntityCommand< Components ... > >( entity_id, components ... ) );
+		stream.Push< AddEntityCommand< Components ... > >( 0, entity_id, std::move( components ) ... );
 
 		return entity_id;
 	}
 
 	void RemoveEntity( EntityID entity, bool and_children = false )
 	{
-		std::scoped_lock lock( m_mutex );
-		m_commands.push_back( std::make_unique< RemoveEntityCommand >( entity, and_children ) );
+		GetStream().Push< RemoveEntityCommand >( 0, entity, and_children );
 	}
 
 	template< typename Component >
 	Component& AddComponent( EntityID entity, Component component )
 	{
-		std::scoped_lock lock( m_mutex );
-		std::unique_ptr< AddComponentCommand< Component > > cmd = std::make_unique< AddComponentCommand< Component > >( entity, component );
-		Component& result = cmd->m_component;
-		m_commands.push_back( std::move( cmd ) );
-		return result;
+		return GetStream().Push< AddComponentCommand< Component > >( ComponentRegistry::GetID< Component >(), entity, std::move( component ) ).m_component;
 	}
 
 	template< typename Component >
 	void RemoveComponent( EntityID entity )
 	{
-		std::scoped_lock lock( m_mutex );
-		m_commands.push_back( std::make_unique< RemoveComponentCommand< Component > >( entity ) );
+		GetStream().Push< RemoveComponentCommand< Component > >( ComponentRegistry::GetID< Component >(), entity );
 	}
 
 	static void IgnorePostCopySceneToWorld( World&, const IDMap& ) {}
@@ -151,28 +257,73 @@ struct CommandBuffer
 	template< typename Func = void(*)( World&, const IDMap& ) >
 	void CopySceneToWorld( std::shared_ptr< Scene > scene, Func func = IgnorePostCopySceneToWorld )
 	{
-		std::scoped_lock lock( m_mutex );
-		m_commands.push_back( std::make_unique< CopySceneToWorldCommand< Func > >( scene, func ) );
+		GetStream().Push< CopySceneToWorldCommand< Func > >( 0, scene, func );
 	}
 
-	void Execute()
+	void Execute();
+
+private:
+	// ids are reserved this many at a time, so that streams rarely touch the same atomics
+	constexpr static u32 c_entityIDReserveCount = 16;
+
+	struct alignas( 64 ) Stream
 	{
-		ZoneScoped;
+		CommandArena m_arena;
+		std::vector< CommandHeader* > m_commands;
+		std::vector< EntityID > m_reservedIDs;
+		u32 m_nextReservedID = 0;
 
-		while ( !m_commands.empty() )
+		template< typename Command, typename ... Args >
+		Command& Push( ComponentID component_id, Args&& ... args )
 		{
-			m_commands.front()->Execute( m_world );
-			m_commands.pop_front();
+			// the header and the command share an allocation
+			constexpr size_t c_commandOffset = ( sizeof( CommandHeader ) + alignof( Command ) - 1 ) / alignof( Command ) * alignof( Command );
+			std::byte* const memory = static_cast< std::byte* >( m_arena.Allocate( c_commandOffset + sizeof( Command ), std::max( alignof( CommandHeader ), alignof( Command ) ) ) );
+
+			Command* const command = new( memory + c_commandOffset ) Command( std::forward< Args >( args ) ... );
+
+			const u64 order_key = onyx::LowLevel::GetWorkerPool().GetCurrentOrderKey();
+			m_commands.push_back( new( memory ) CommandHeader { &CommandType::s_singleton< Command >, order_key, command, component_id } );
+
+			return *command;
 		}
 
-		m_world.m_queryManager.UpdateNeedsRerun( m_world );
-	}
+		EntityID TakeEntityID( World& world )
+		{
+			if ( m_nextReservedID == m_reservedIDs.size() )
+			{
+				m_reservedIDs.resize( m_reservedIDs.size() + c_entityIDReserveCount );
+				world.ReserveEntityIDs( std::span( m_reservedIDs ).subspan( m_nextReservedID ) );
+			}
 
-private:
+			return m_reservedIDs[ m_nextReservedID++ ];
+		}
+	};
 
-	std::mutex m_mutex;
 	World& m_world;
-	std::deque< std::unique_ptr< ICommand > > m_commands;
+
+	// one per worker, plus one for every other thread, created the first time each one is used
+	std::vector< std::unique_ptr< Stream > > m_streams;
+
+	// scratch space for Execute
+	std::vector< CommandHeader* > m_mergedCommands;
+	std::vector< CommandHeader* > m_commandsByKind[ u32( CommandKind::Count ) ];
+
+	// runs commands that don't include any scene copies or removals, batched by kind
+	void ExecuteBatched( std::span< CommandHeader* const > commands );
+
+	Stream& GetStream()
+	{
+		std::unique_ptr< Stream >& stream = m_streams[ onyx::LowLevel::GetWorkerPool().GetCurrentThreadIndex() ];
+		if ( !stream )
+			stream = std::make_unique< Stream >();
+
+		return *stream;
+	}
+
+	void DestroyCommands();
 };
 
 }
+
+THREAD_SAFE_CONTEXT( onyx::ecs::CommandBuffer );
@@ -13,15 +13,13 @@ using IDMap = std::vector< std::pair< EntityID, EntityID > >;
 
 struct IComponentReflector
 {
-	IComponentReflector( const char* const name, size_t type_hash )
+	IComponentReflector( const char* const name )
 		: m_name( name )
 		, m_nameHash( BjSON::HashName( name ) )
-		, m_typeHash( type_hash )
 	{}
 	
 	const char* const m_name;
 	const BjSON::NameHash m_nameHash;
-	const size_t m_typeHash;
 
 	virtual void DeserialiseComponent( const BjSON::IReadOnlyObject& reader, AssetManager& asset_manager, World& world, EntityID entity ) const = 0;
 	virtual void SerialiseComponent( BjSON::IReadWriteObject& writer, World::EntityIterator& entity ) const = 0;
@@ -56,20 +54,22 @@ struct ComponentReflectorTable
 {
 	static ComponentReflectorTable s_singleton;
 
-	const IComponentReflector* GetReflector( size_t component_type_hash ) const;
+	const IComponentReflector* GetReflectorByID( ComponentID component_id ) const;
 	const IComponentReflector* GetReflector( BjSON::NameHash component_name_hash ) const;
 
+	// registering reflectors is also what gives components their ids
+	// so reflectors should always be registered in the same order, before any worlds are used
 	template< typename Component >
 	void RegisterReflector()
 	{
 		RegisterReflector(
 			onyx::ecs::ComponentReflector< Component >::s_singleton,
 			onyx::ecs::ComponentReflector< Component >::s_singleton.m_nameHash,
-			onyx::ecs::ComponentReflector< Component >::s_singleton.m_typeHash
+			ComponentRegistry::GetID< Component >()
 		);
 	}
 
-	void RegisterReflector( const IComponentReflector& reflector, BjSON::NameHash component_name_hash, size_t component_type_hash );
+	void RegisterReflector( const IComponentReflector& reflector, BjSON::NameHash component_name_hash, ComponentID component_id );
 
 	void SerialiseEdits( BjSON::IReadWriteObject& writer, const std::map< BjSON::NameHash, std::set< BjSON::NameHash > >& edits, World& world, EntityID entity );
 	void DoEditorUI( AssetManager& asset_manager, World& world, EntityID entity );
@@ -79,7 +79,7 @@ private:
 	ComponentReflectorTable() = default;
 
 	std::vector< const IComponentReflector* > m_reflectors;
-	std::unordered_map< size_t, const IComponentReflector* > m_typeHashLookup;
+	std::vector< const IComponentReflector* > m_componentIDLookup;
 	std::unordered_map< BjSON::NameHash, const IComponentReflector* > m_typeNameLookup;
 };
 
@@ -97,7 +97,7 @@ private:
 		if ( !world.GetComponent< Component >( entity ) && ( search_term.empty() || strstr( #Component, search_term.c_str() ) ) && ImGui::Selectable( #Component ) )\
 			world.AddComponent( entity, Component() );\
 	}\
-	ComponentReflector() : IComponentReflector( #Component, typeid( Component ).hash_code() ) {}\
+	ComponentReflector() : IComponentReflector( #Component ) {}\
 	static ComponentReflector s_singleton
 
 #define DEFINE_COMPONENT_REFLECTOR( Component )\
@@ -0,0 +1,40 @@
+#include "ComponentRegistry.h"
+
+#include <mutex>
+#include <vector>
+
+namespace onyx::ecs
+{
+
+static std::mutex s_mutex;
+static std::vector< size_t > s_componentTypeHashes;
+static bool s_sealed = false;
+
+void ComponentRegistry::Seal()
+{
+	std::scoped_lock lock( s_mutex );
+	s_sealed = true;
+}
+
+u32 ComponentRegistry::GetCount()
+{
+	std::scoped_lock lock( s_mutex );
+	return u32( s_componentTypeHashes.size() );
+}
+
+ComponentID ComponentRegistry::Register( size_t component_type_hash )
+{
+	std::scoped_lock lock( s_mutex );
+
+	for ( ComponentID id = 0; id < s_componentTypeHashes.size(); ++id )
+		if ( s_componentTypeHashes[ id ] == component_type_hash )
+			return id;
+
+	STRONG_ASSERT( !s_sealed, "Component type registered after startup, register it in RegisterReflectors" );
+	STRONG_ASSERT( s_componentTypeHashes.size() < c_maxComponentTypes, "Too many component types, increase c_maxComponentTypes" );
+
+	s_componentTypeHashes.push_back( component_type_hash );
+	return ComponentID( s_componentTypeHashes.size() - 1 );
+}
+
+}
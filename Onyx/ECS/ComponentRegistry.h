@@ -0,0 +1,48 @@
+#pragma once
+
+#include <bitset>
+#include <typeinfo>
+
+namespace onyx::ecs
+{
+
+// each component type gets a small dense id, so per-component data can live in vectors, and sets of components in bitsets
+// ids are handed out in the order component types are first seen, so every type is registered up front in a fixed order
+// (in RegisterReflectors, or with Register for types without reflectors) and then the registry is sealed
+// after that a new type is an error, its id would depend on which thread happened to use it first
+using ComponentID = u32;
+
+constexpr static u32 c_maxComponentTypes = 128;
+using ComponentSet = std::bitset< c_maxComponentTypes >;
+
+struct ComponentRegistry
+{
+	template< typename Component >
+	static ComponentID GetID()
+	{
+		static const ComponentID s_id = Register( typeid( Component ).hash_code() );
+		return s_id;
+	}
+
+	template< typename ... Components >
+	static ComponentSet GetSet()
+	{
+		ComponentSet set;
+		( set.set( GetID< Components >() ), ... );
+		return set;
+	}
+
+	// for component types without reflectors
+	template< typename ... Components >
+	static void Register() { ( GetID< Components >(), ... ); }
+
+	// called once at startup, after everything has been registered
+	static void Seal();
+
+	static u32 GetCount();
+
+private:
+	static ComponentID Register( size_t component_type_hash );
+};
+
+}
@@ -1,112 +1,202 @@
 #include "ComponentTable.h"
 
+#include <new>
+
 namespace onyx::ecs
 {
 
-GenericComponentTable::Iterator& GenericComponentTable::Iterator::operator ++()
+PagePool::PagePool( size_t block_size )
+	// round blocks up to the alignment so every block in a slab stays aligned
+	: m_blockSize( ( block_size + c_blockAlignment - 1 ) & ~( c_blockAlignment - 1 ) )
+	, m_slabSize( std::max( m_blockSize, c_minSlabSize ) / m_blockSize * m_blockSize )
+{}
+
+PagePool::~PagePool()
 {
-	// we can't incremenet, we've walked off the table
-	if ( m_page == m_table.End() )
-		return *this;
+	for ( void* slab : m_slabs )
+		::operator delete( slab, std::align_val_t( c_slabAlignment ) );
+}
 
-	// get the next component in this page, if it exists
-	m_index = m_page->GetNextOccupantIndex( m_index );
-	if ( m_index < 16 )
-		return *this;
+void* PagePool::Allocate()
+{
+	ZoneScoped;
 
-	// if it doesn't, step to the next page, if this is off the table, return
-	while ( ++m_page != m_table.End() && m_page->m_occupancy == 0 );
-	if ( m_page == m_table.End() )
-		return *this;
+	if ( m_freeList.empty() )
+		AllocateSlab();
 
-	// get the next component in this table
-	m_index = m_page->GetNextOccupantIndex();
-	return *this;
+	void* const block = m_freeList.back();
+	m_freeList.pop_back();
+
+	m_highWaterMark = std::max( m_highWaterMark, ++m_liveBlocks );
+	return block;
 }
 
-EntityID GenericComponentTable::Iterator::FindNextDirtyEntityID() const
+void PagePool::Free( void* block )
 {
-	Page* page = m_page;
+#	if _DEBUG
+	STRONG_ASSERT( m_liveBlocks > 0, "Freeing more blocks than were allocated from a page pool" );
+#	endif
 
-	// we've reached the end of these components
-	if ( page == m_table.End() )
-		return NoEntity;
-
-	// check if our current page has any dirty components after the current one
-	if ( const u8 next_dirty = page->GetNextDirtyIndex( m_index ); next_dirty < 16 )
-		return page->GetEntityID( next_dirty );
+	--m_liveBlocks;
+	m_freeList.push_back( block );
+}
 
-	// iterate through the pages until we reach the end, or one that has any dirty components
-	while ( ++page != m_table.End() && page->m_dirty == 0 );
+void PagePool::AllocateSlab()
+{
+	ZoneScoped;
 
-	// if we got to the end, there are no more dirty components
-	if ( page == m_table.End() )
-		return NoEntity;
+	byte* const slab = static_cast< byte* >( ::operator new( m_slabSize, std::align_val_t( c_slabAlignment ) ) );
+	m_slabs.push_back( slab );
 
-	// Gentlemen, we got 'em
-	return page->GetEntityID( page->GetNextDirtyIndex() );
+	// push the blocks in reverse, so that they get handed out in address order
+	const size_t block_count = m_slabSize / m_blockSize;
+	for ( size_t block_index = block_count; block_index-- > 0; )
+		m_freeList.push_back( slab + block_index * m_blockSize );
 }
 
-EntityID GenericComponentTable::Iterator::GetNextEntityID() const
+GenericComponentTable::Page* GenericComponentTable::FindPage( u32 page_index ) const
 {
-	if ( m_page == m_table.End() ) return NoEntity;
-	
-	if ( u8 next_index = m_page->GetNextOccupantIndex( m_index ); next_index < 16 )
-		return m_page->GetEntityID( next_index );
+	for ( u32 block_index = page_index >> c_blockShift; block_index < m_directory.size(); ++block_index )
+	{
+		PageBlock* const block = m_directory[ block_index ].get();
+
+		// only the first block we look at might start part way through
+		const u32 first_page = ( block_index == page_index >> c_blockShift ) ? page_index & c_blockPageMask : 0;
 
-	Page* next_page = m_page + 1;
-	while ( next_page != m_table.End() && next_page->m_occupancy == 0 )
-		++next_page;
+		if ( !block )
+			continue;
 
-	if ( next_page == m_table.End() ) return NoEntity;
+		for ( u32 word_index = first_page / 64; word_index < COUNTOF( block->m_allocated ); ++word_index )
+		{
+			u64 allocated = block->m_allocated[ word_index ];
 
-	return next_page->GetEntityID( next_page->GetNextOccupantIndex() );
+			if ( word_index == first_page / 64 )
+				allocated &= ~0ull << ( first_page % 64 );
+
+			if ( allocated )
+				return &block->m_pages[ word_index * 64 + std::countr_zero( allocated ) ];
+		}
+	}
+
+	return nullptr;
 }
 
-void GenericComponentTable::Iterator::GoToNext()
+GenericComponentTable::Page* GenericComponentTable::GetOrAllocatePage( u32 page_index )
 {
-	// don't risk dereferencing endPage
-	if ( m_page == m_table.End() ) return;
+	const u32 block_index = page_index >> c_blockShift;
+	const u32 block_page = page_index & c_blockPageMask;
 
-	// go to the next occupant in this page, if one exists, then return
-	if ( ( m_index = m_page->GetNextOccupantIndex( m_index ) ) < 16 ) return;
+	if ( block_index >= m_directory.size() )
+		m_directory.resize( block_index + 1 );
 
-	// go to the next occupied page, if it is the end page, return
-	while ( ++m_page != m_table.End() && m_page->m_occupancy == 0 );
-	if ( m_page == m_table.End() ) return;
+	std::unique_ptr< PageBlock >& block = m_directory[ block_index ];
+	if ( !block )
+		block = std::make_unique< PageBlock >();
 
-	// go to the next occupant in the new page
-	m_index = m_page->GetNextOccupantIndex();
+	Page& page = block->m_pages[ block_page ];
+	if ( !page.IsAllocated() )
+	{
+		page.AllocateComponents( m_pagePool, page_index << m_pageShift, m_pageShift );
+		block->m_allocated[ block_page / 64 ] |= 1ull << ( block_page % 64 );
+	}
+
+	return &page;
 }
 
-void GenericComponentTable::Iterator::GoTo( EntityID entity )
+u64 GenericComponentTable::GetChunkMask( u32 chunk_index, bool dirty ) const
 {
-	// don't do anything if we've already reached the end of the array
-	if ( m_page == m_table.End() )
-		return;
+	const u32 first_entity = chunk_index << c_chunkShift;
+
+	// pages at least as big as a chunk have the whole chunk in one word of their bitmaps
+	if ( m_pageShift >= c_chunkShift )
+	{
+		const Page* const page = GetPage( first_entity >> m_pageShift );
+		if ( !page )
+			return 0;
+
+		const u32 word_index = ( first_entity & ( page->GetPageSize() - 1 ) ) / 64;
+		return dirty ? page->m_dirty[ word_index ] : page->m_occupancy[ word_index ];
+	}
+
+	// smaller pages each fill in part of the chunk
+	u64 mask = 0;
 
-	// extract the page id and index
-	const u32 page_id = u32( entity ) & Page::c_pageIdMask;
-	const u8 idx = u32( entity ) & Page::c_pageIndexMask;
+	const u32 first_page = first_entity >> m_pageShift;
+	for ( u32 page_offset = 0; page_offset < ( c_chunkSize >> m_pageShift ); ++page_offset )
+		if ( const Page* const page = GetPage( first_page + page_offset ) )
+			mask |= ( dirty ? page->m_dirty[ 0 ] : page->m_occupancy[ 0 ] ) << ( page_offset << m_pageShift );
 
-	// walk through the page list to the matching page
-	while ( m_page != m_table.End() && m_page->m_pageId < page_id )
-		++m_page;
+	return mask;
+}
 
-	// we reached the end and didn't find it
-	if ( m_page == m_table.End() )
-		return;
+u32 GenericComponentTable::FindChunk( u32 chunk_index ) const
+{
+	const Page* const page = FindPage( ( chunk_index << c_chunkShift ) >> m_pageShift );
+	if ( !page )
+		return UINT32_MAX;
 
-	// we walked as far as we could before over stepping, but didn't find the component
-	// so go to the last component in this page
-	if ( m_page->m_pageId != page_id )
+	// a big page may start before the chunk we asked for
+	return std::max( chunk_index, page->m_pageId >> c_chunkShift );
+}
+
+void GenericComponentTable::CleanUpPages()
+{
+	m_changeLog.clear();
+
+	for ( std::unique_ptr< PageBlock >& block : m_directory )
 	{
-		m_index = m_page->GetNextOccupantIndex();
-		return;
+		if ( !block )
+			continue;
+
+		for ( u32 block_page = 0; block_page < c_pagesPerBlock; ++block_page )
+		{
+			Page& page = block->m_pages[ block_page ];
+			page.ClearDirty();
+
+			if ( !page.IsAllocated() || !page.IsEmpty() )
+				continue;
+
+			page.FreeComponents( m_pagePool );
+			block->m_allocated[ block_page / 64 ] &= ~( 1ull << ( block_page % 64 ) );
+		}
 	}
+}
+
+GenericComponentTable::Iterator& GenericComponentTable::Iterator::operator ++()
+{
+	// we can't incremenet, we've walked off the table
+	if ( !m_page )
+		return *this;
+
+	// get the next component in this page, if it exists
+	m_index = m_page->GetNextOccupantIndex( m_index );
+	if ( m_index < Page::c_maxPageSize )
+		return *this;
+
+	// if it doesn't, step to the next page, if this is off the table, return
+	while ( ( m_page = m_table.GetNextPage( *m_page ) ) && m_page->IsEmpty() );
+	if ( !m_page )
+		return *this;
+
+	// get the next component in this table
+	m_index = m_page->GetNextOccupantIndex();
+	return *this;
+}
 
-	// we found the right page!
-	m_index = idx;
+void GenericComponentTable::Iterator::GoToNext()
+{
+	// don't risk dereferencing a missing page
+	if ( !m_page ) return;
+
+	// go to the next occupant in this page, if one exists, then return
+	if ( ( m_index = m_page->GetNextOccupantIndex( m_index ) ) < Page::c_maxPageSize ) return;
+
+	// go to the next occupied page, if there isn't one, return
+	while ( ( m_page = m_table.GetNextPage( *m_page ) ) && m_page->IsEmpty() );
+	if ( !m_page ) return;
+
+	// go to the next occupant in the new page
+	m_index = m_page->GetNextOccupantIndex();
 }
 
-}
\ No newline at end of file
+}
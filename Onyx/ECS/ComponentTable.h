@@ -4,6 +4,9 @@
 
 #include "tracy/Tracy.hpp"
 
+#include <bit>
+#include <memory>
+#include <span>
 #include <vector>
 
 namespace onyx::ecs
@@ -15,6 +18,63 @@ struct World;
 template< typename Component >
 struct ComponentTable;
 
+// the number of components stored in each page of a component's table is 2^c_pageShift
+// small or densely populated components can use bigger pages to cut down on allocations, see COMPONENT_PAGE_SIZE
+template< typename Component >
+struct ComponentPageShift
+{
+	static constexpr u32 c_pageShift = 4;
+};
+
+// hands out fixed size, cache line aligned blocks of memory for component pages
+// blocks are carved out of larger slabs, and freed blocks go onto a free list to be reused
+// memory is only given back to the system when the pool is destroyed
+struct PagePool
+{
+	constexpr static size_t c_blockAlignment = 64;
+	constexpr static size_t c_slabAlignment = 4096;
+	constexpr static size_t c_minSlabSize = 64 * 1024;
+
+	PagePool( size_t block_size );
+	~PagePool();
+
+	PagePool( PagePool&& other ) = delete;
+	PagePool( const PagePool& other ) = delete;
+
+	PagePool& operator =( PagePool&& other ) = delete;
+	PagePool& operator =( const PagePool& other ) = delete;
+
+	void* Allocate();
+	void Free( void* block );
+
+	size_t GetBlockSize() const { return m_blockSize; }
+	u32 GetLiveBlockCount() const { return m_liveBlocks; }
+	u32 GetFreeBlockCount() const { return u32( m_freeList.size() ); }
+
+	// the most blocks that have been in use at once
+	u32 GetHighWaterMark() const { return m_highWaterMark; }
+
+	// the total memory taken from the system, whether it's in use or not
+	size_t GetReservedBytes() const { return m_slabs.size() * m_slabSize; }
+
+private:
+	size_t m_blockSize;
+	size_t m_slabSize;
+	std::vector< void* > m_slabs;
+	std::vector< void* > m_freeList;
+	u32 m_liveBlocks = 0;
+	u32 m_highWaterMark = 0;
+
+	void AllocateSlab();
+};
+
+#define COMPONENT_PAGE_SIZE( Component, size )\
+	template<> struct onyx::ecs::ComponentPageShift< Component >\
+	{\
+		static_assert( size == 16 || size == 64 || size == 256, "Component page sizes must be 16, 64, or 256" );\
+		static constexpr u32 c_pageShift = std::countr_zero( u32( size ) );\
+	}
+
 struct GenericComponentTable
 {
 	template< typename Component >
@@ -22,16 +82,18 @@ struct GenericComponentTable
 
 	struct Page
 	{
-		Page( size_t component_size, u32 page_id )
-			: m_components( malloc( component_size * 16 ) )
-			, m_pageId( page_id )
-		{}
+		void AllocateComponents( PagePool& pool, u32 page_id, u32 page_shift )
+		{
+			m_components = pool.Allocate();
+			m_pageId = page_id;
+			m_pageShift = page_shift;
+		}
 
-		void FreeComponents()
+		void FreeComponents( PagePool& pool )
 		{
 			if ( m_components )
 			{
-				free( m_components );
+				pool.Free( m_components );
 				m_components = nullptr;
 			}
 		}
@@ -44,6 +106,7 @@ struct GenericComponentTable
 		{
 			std::swap( m_components, other.m_components );
 			std::swap( m_pageId, other.m_pageId );
+			std::swap( m_pageShift, other.m_pageShift );
 			std::swap( m_occupancy, other.m_occupancy );
 			std::swap( m_dirty, other.m_dirty );
 
@@ -53,112 +116,146 @@ struct GenericComponentTable
 		Page( const Page& other ) = delete;
 		Page& operator =( const Page& other ) = delete;
 
-		constexpr static u32 c_pageIndexMask = 0xf;
-		constexpr static u32 c_pageIdMask = ~c_pageIndexMask;
+		constexpr static u32 c_maxPageShift = 8;
+		constexpr static u32 c_maxPageSize = 1u << c_maxPageShift;
+		constexpr static u32 c_bitmapWords = c_maxPageSize / 64;
+
+		using Bitmap = u64[ c_bitmapWords ];
 
 		void* m_components = nullptr;
 
-		// the top 28 bits of the page id match the top 28 bits of the entity ids of all of its components
-		// the bottom 4 bits are 0
+		// the top bits of the page id match the top bits of the entity ids of all of its components
+		// the bottom m_pageShift bits are 0
 		u32 m_pageId = 0;
-		u16 m_occupancy = 0;
-		u16 m_dirty = 0;
+		u32 m_pageShift = 0;
+		Bitmap m_occupancy {};
+		Bitmap m_dirty {};
 
+		// destroys all of the components, but keeps the memory
 		template< typename Component >
 		void Clear()
 		{
 			if ( !m_components )
 				return;
 
-			u8 next_occupant;
-			while ( (next_occupant = GetNextOccupantIndex()) < 16 )
+			u32 next_occupant;
+			while ( (next_occupant = GetNextOccupantIndex()) < c_maxPageSize )
 				RemoveComponent< Component >( next_occupant );
-
-			FreeComponents();
 		}
 
 		template< typename Component >
-		Component* GetComponent( u8 index ) const
+		Component* GetComponent( u32 index ) const
 		{
 			return HasComponent( index ) ? Components< Component >() + index : nullptr;
 		}
 
 		template< typename Component >
-		Component& AddComponent( u8 index, Component&& component )
+		Component& AddComponent( u32 index, Component&& component )
 		{
 			Component* addr = Components< Component >() + index;
 
-			if ( m_occupancy & (1 << index) )
+			if ( TestBit( m_occupancy, index ) )
 				return *addr = component;
 
-			m_occupancy |= (1 << index);
-			m_dirty |= (1 << index);
+			SetBit( m_occupancy, index );
+			SetBit( m_dirty, index );
 			return *new(addr) Component( std::move( component ) );
 		}
 
 		template< typename Component >
-		bool RemoveComponent( u8 index )
+		bool RemoveComponent( u32 index )
 		{
 			if ( !HasComponent( index ) )
 				return false;
 
 			Components< Component >()[ index ].~Component();
-			m_occupancy &= ~(1 << index);
-			m_dirty |= (1 << index);
+			ClearBit( m_occupancy, index );
+			SetBit( m_dirty, index );
 
 			return true;
 		}
 
-		inline EntityID GetEntityID( u8 index ) const
+		inline EntityID GetEntityID( u32 index ) const
 		{
-			return ( index < 16 ) ? EntityID( m_pageId + index ) : NoEntity;
+			return ( index < GetPageSize() ) ? EntityID( m_pageId + index ) : NoEntity;
 		}
 
-		inline bool HasComponent( u8 index ) const
+		inline bool HasComponent( u32 index ) const
 		{
 #			if _DEBUG
-			STRONG_ASSERT( ( index & c_pageIndexMask ) == index, "Invalid index into a component page: {}", index );
+			STRONG_ASSERT( index < GetPageSize(), "Invalid index into a component page: {}", index );
 #			endif
 
-			return m_occupancy & ( 1u << index );
+			return TestBit( m_occupancy, index );
 		}
 
-#		if _WIN32 // thanks MSVC, very cool!
-		__declspec(noinline)
-#		endif
-		u8 GetNextOccupantIndex( u8 after_index = ~0 ) const
-		{
-			return std::countr_zero( u16( m_occupancy & ~( ( 1u << ( after_index + 1 ) ) - 1 ) ) );
-		}
+		// returns c_maxPageSize if there are no more occupants
+		u32 GetNextOccupantIndex( u32 after_index = ~0u ) const { return FindNextBit( m_occupancy, after_index ); }
 
-#		if _WIN32 // thanks MSVC, very cool!
-		__declspec(noinline)
-#		endif
-		u8 GetNextDirtyIndex( u8 after_index = 0 ) const
-		{
-			return std::countr_zero( u16( m_dirty & ~( ( 1u << ( after_index + 1 ) ) - 1 ) ) );
-		}
+		// returns c_maxPageSize if there are no more dirty components
+		u32 GetNextDirtyIndex( u32 after_index = ~0u ) const { return FindNextBit( m_dirty, after_index ); }
 
-		inline bool IsDirty( u8 index ) const
+		inline bool IsDirty( u32 index ) const
 		{
 #			if _DEBUG
-			STRONG_ASSERT( ( index & c_pageIndexMask ) == index, "Invalid index into a component page: {}", index );
+			STRONG_ASSERT( index < GetPageSize(), "Invalid index into a component page: {}", index );
 #			endif
 
-			return m_dirty & ( 1u << index );
+			return TestBit( m_dirty, index );
 		}
 
-		inline void RemoveDirtyFlag( u8 index )
+		inline void RemoveDirtyFlag( u32 index )
 		{
 #			if _DEBUG
-			STRONG_ASSERT( ( index & c_pageIndexMask ) == index, "Invalid index into a component page: {}", index );
+			STRONG_ASSERT( index < GetPageSize(), "Invalid index into a component page: {}", index );
 #			endif
 
-			m_dirty &= ~( 1u << index );
+			ClearBit( m_dirty, index );
 		}
 
-		static inline int PageIDComparator( const Page& page, u32 page_id )
-		{ return page.m_pageId < page_id; }
+		inline bool IsEmpty() const { return !AnyBits( m_occupancy ); }
+		inline bool HasDirty() const { return AnyBits( m_dirty ); }
+		inline void ClearDirty() { std::fill( std::begin( m_dirty ), std::end( m_dirty ), 0ull ); }
+
+		inline bool IsAllocated() const { return m_components; }
+		inline u32 GetPageSize() const { return 1u << m_pageShift; }
+		inline u32 GetPageIndex() const { return m_pageId >> m_pageShift; }
+
+		static inline bool TestBit( const Bitmap& bitmap, u32 index ) { return bitmap[ index / 64 ] & ( 1ull << ( index % 64 ) ); }
+		static inline void SetBit( Bitmap& bitmap, u32 index ) { bitmap[ index / 64 ] |= 1ull << ( index % 64 ); }
+		static inline void ClearBit( Bitmap& bitmap, u32 index ) { bitmap[ index / 64 ] &= ~( 1ull << ( index % 64 ) ); }
+
+		static inline bool AnyBits( const Bitmap& bitmap )
+		{
+			u64 any = 0;
+			for ( const u64 word : bitmap )
+				any |= word;
+
+			return any;
+		}
+
+		// find the first set bit after the given index, pass ~0u to search from the start
+		// returns c_maxPageSize if there isn't one
+#		if _WIN32 // thanks MSVC, very cool!
+		__declspec(noinline)
+#		endif
+		static u32 FindNextBit( const Bitmap& bitmap, u32 after_index )
+		{
+			const u32 first = after_index + 1;
+
+			for ( u32 word_index = first / 64; word_index < c_bitmapWords; ++word_index )
+			{
+				u64 word = bitmap[ word_index ];
+
+				if ( word_index == first / 64 )
+					word &= ~0ull << ( first % 64 );
+
+				if ( word )
+					return word_index * 64 + std::countr_zero( word );
+			}
+
+			return c_maxPageSize;
+		}
 
 	private:
 		template< typename Component >
@@ -169,26 +266,17 @@ struct GenericComponentTable
 	{
 		GenericComponentTable& m_table;
 		Page* m_page = nullptr;
-		u8 m_index = 0;
+		u32 m_index = 0;
 
-		Iterator( GenericComponentTable& table, bool skip_dirty = true )
+		Iterator( GenericComponentTable& table )
 			: m_table( table )
-			, m_page( table.Begin() )
+			, m_page( table.GetFirstPage() )
 		{
-			if ( m_page == m_table.End() )
-				return;
+			while ( m_page && m_page->IsEmpty() )
+				m_page = m_table.GetNextPage( *m_page );
 
-			if ( skip_dirty )
-			{
-				while ( m_page->m_occupancy == 0 && ++m_page != m_table.End() );
-
-				if ( m_page != m_table.End() )
-					m_index = m_page->GetNextOccupantIndex();
-			}
-			else
-			{
-				m_index = std::min( m_page->GetNextDirtyIndex(), m_page->GetNextOccupantIndex() );
-			}
+			if ( m_page )
+				m_index = m_page->GetNextOccupantIndex();
 		}
 
 		template< typename Component >
@@ -213,12 +301,12 @@ struct GenericComponentTable
 			return *reinterpret_cast< const ComponentTable< Component >::Iterator* >( this );
 		}
 
-		inline operator bool() const { return m_page != m_table.End(); }
+		inline operator bool() const { return m_page; }
 		Iterator& operator ++();
 
 		inline EntityID GetEntityID() const
 		{
-			return m_page == m_table.End() ? NoEntity
+			return !m_page ? NoEntity
 				: m_page->GetEntityID( m_index );
 		}
 
@@ -230,47 +318,38 @@ struct GenericComponentTable
 				"Trying to use GenericComponentTable with a type other than the one it was created for" );
 #			endif
 
-			if ( m_page == m_table.End() )
+			if ( !m_page )
 				return nullptr;
 
 			return m_page->GetComponent< Component >( m_index );
 		}
 
-		inline bool IsDirty() const { return m_index < 16 && m_page != m_table.End() && m_page->IsDirty( m_index ); }
-		inline void RemoveDirtyFlag() { if ( m_index < 16 && m_page != m_table.End() ) m_page->RemoveDirtyFlag( m_index ); }
-
-		EntityID FindNextDirtyEntityID() const;
-		EntityID GetNextEntityID() const;
 		void GoToNext();
-
-		// walk _forward_ to the specified entity ID
-		// if not present, walk to the next entity ID that is occupied
-		void GoTo( EntityID entity );
-
-		inline void CopyToWorld( World& world, EntityID entity ) const
-		{
-			if ( m_page != m_table.End() )
-				m_table.CopyComponentToWorld( world, *m_page, m_index, entity );
-		}
 	};
 
 	struct MetaData
 	{
 		size_t componentType;
+		size_t componentSize;
+		u32 pageShift;
 		void( *DestructorCallback )( GenericComponentTable& self );
-		void( *CopyComponentToWorld )( World& world, Page& page, u8 index, EntityID dst_id );
+		void( *CopyComponentToWorld )( World& world, Page& page, u32 index, EntityID dst_id );
 		void( *RemoveComponent )( GenericComponentTable& self, EntityID id );
+		void( *RemoveComponents )( GenericComponentTable& self, std::span< const EntityID > ids );
 
 	private:
 		template< typename Component >
 		static void __DestructorCallback( GenericComponentTable& self )
 		{
-			for ( auto& page : self.m_pages )
-				page.Clear< Component >();
+			static_assert( alignof( Component ) <= PagePool::c_blockAlignment, "Component is over aligned for its page pool" );
+
+			// the memory itself is released by the page pool
+			for ( Page* page = self.GetFirstPage(); page; page = self.GetNextPage( *page ) )
+				page->Clear< Component >();
 		}
 
 		template< typename Component >
-		static void __CopyComponentToWorld( World& world, Page& page, u8 index, EntityID dst_id );
+		static void __CopyComponentToWorld( World& world, Page& page, u32 index, EntityID dst_id );
 
 		template< typename Component >
 		static void __RemoveComponent( GenericComponentTable& self, EntityID id )
@@ -278,15 +357,27 @@ struct GenericComponentTable
 			self.RemoveComponent< Component >( id );
 		}
 
+		template< typename Component >
+		static void __RemoveComponents( GenericComponentTable& self, std::span< const EntityID > ids )
+		{
+			self.RemoveComponents< Component >( ids );
+		}
+
 		constexpr MetaData(
 			decltype( componentType ) componentType,
+			decltype( componentSize ) componentSize,
+			decltype( pageShift ) pageShift,
 			decltype( DestructorCallback ) DestructorCallback,
 			decltype( CopyComponentToWorld ) CopyComponentToWorld,
-			decltype( RemoveComponent ) RemoveComponent
+			decltype( RemoveComponent ) RemoveComponent,
+			decltype( RemoveComponents ) RemoveComponents
 		) : componentType( componentType )
+		  , componentSize( componentSize )
+		  , pageShift( pageShift )
 		  , DestructorCallback( DestructorCallback )
 		  , CopyComponentToWorld( CopyComponentToWorld )
 		  , RemoveComponent( RemoveComponent )
+		  , RemoveComponents( RemoveComponents )
 		{}
 
 	public:
@@ -296,16 +387,7 @@ struct GenericComponentTable
 
 	Iterator Iter() { return Iterator( *this ); }
 
-	void CleanUpPages()
-	{
-		std::erase_if( m_pages, []( Page& page )
-			{
-				page.m_dirty = 0;
-				if ( page.m_occupancy != 0 ) return false;
-				page.FreeComponents();
-				return true;
-			} );
-	}
+	void CleanUpPages();
 
 	template< typename Component >
 	Component* GetComponent( EntityID entity )
@@ -317,14 +399,8 @@ struct GenericComponentTable
 
 		ZoneScoped;
 
-		const u32 page_id = (u32)entity & Page::c_pageIdMask;
-		const u8 index = (u32)entity & Page::c_pageIndexMask;
-
-		auto page = std::lower_bound( m_pages.begin(), m_pages.end(), page_id, Page::PageIDComparator );
-		if ( page == m_pages.end() )
-			return nullptr;
-
-		return page->m_pageId != page_id ? nullptr : page->GetComponent< Component >( index );
+		const Page* const page = GetPage( GetPageIndex( entity ) );
+		return !page ? nullptr : page->GetComponent< Component >( GetIndexInPage( entity ) );
 	}
 
 	template< typename Component >
@@ -337,14 +413,12 @@ struct GenericComponentTable
 
 		ZoneScoped;
 
-		const u32 page_id = (u32)entity & Page::c_pageIdMask;
-		const u8 index = (u32)entity & Page::c_pageIndexMask;
+		const u32 index = GetIndexInPage( entity );
+		Page* const page = GetOrAllocatePage( GetPageIndex( entity ) );
 
-		auto page = std::lower_bound( m_pages.begin(), m_pages.end(), page_id, Page::PageIDComparator );
-		if ( page == m_pages.end() || page->m_pageId != page_id )
-			page = m_pages.emplace( page, sizeof( Component ), page_id );
+		if ( !page->HasComponent( index ) )
+			LogChange( entity );
 
-		m_hasChanged |= !page->HasComponent( index );
 		return page->AddComponent< Component >( index, std::move( component ) );
 	}
 
@@ -358,14 +432,39 @@ struct GenericComponentTable
 
 		ZoneScoped;
 
-		const u32 page_id = (u32)entity & Page::c_pageIdMask;
-		const u8 index = (u32)entity & Page::c_pageIndexMask;
-
-		auto page = std::lower_bound( m_pages.begin(), m_pages.end(), page_id, Page::PageIDComparator );
-		if ( page == m_pages.end() || page->m_pageId != page_id )
+		Page* const page = GetPage( GetPageIndex( entity ) );
+		if ( !page )
 			return;
 
-		m_hasChanged |= page->RemoveComponent< Component >( index );
+		if ( page->RemoveComponent< Component >( GetIndexInPage( entity ) ) )
+			LogChange( entity );
+	}
+
+	// the ids should be sorted, so that each page only gets looked up once
+	template< typename Component >
+	void RemoveComponents( std::span< const EntityID > entities )
+	{
+#		if _DEBUG
+		STRONG_ASSERT( IsOfType< Component >(),
+			"Trying to use GenericComponentTable with a type other than the one it was created for" );
+#		endif
+
+		ZoneScoped;
+
+		Page* page = nullptr;
+		u32 page_index = UINT32_MAX;
+
+		for ( const EntityID entity : entities )
+		{
+			if ( GetPageIndex( entity ) != page_index )
+			{
+				page_index = GetPageIndex( entity );
+				page = GetPage( page_index );
+			}
+
+			if ( page && page->RemoveComponent< Component >( GetIndexInPage( entity ) ) )
+				LogChange( entity );
+		}
 	}
 
 	template< typename Component >
@@ -395,8 +494,15 @@ struct GenericComponentTable
 		m_metaData.RemoveComponent( *this, entity );
 	}
 
+	void RemoveComponents( std::span< const EntityID > entities )
+	{
+		m_metaData.RemoveComponents( *this, entities );
+	}
+
 	GenericComponentTable( const MetaData& meta_data )
 		: m_metaData( meta_data )
+		, m_pageShift( meta_data.pageShift )
+		, m_pagePool( meta_data.componentSize << meta_data.pageShift )
 	{}
 
 	~GenericComponentTable()
@@ -410,30 +516,95 @@ struct GenericComponentTable
 	GenericComponentTable& operator =( GenericComponentTable&& other ) = delete;
 	GenericComponentTable& operator =( const GenericComponentTable& other ) = delete;
 
-	void CopyComponentToWorld( World& world, Page& page, u8 index, EntityID entity_id ) const
+	void CopyComponentToWorld( World& world, Page& page, u32 index, EntityID entity_id ) const
 	{
 		m_metaData.CopyComponentToWorld( world, page, index, entity_id );
 	}
 
+	// pages are stored in fixed size blocks, found through a directory indexed by the top bits of the page index
+	// so finding the page for an entity is a shift and two loads, and blocks never move once allocated
+	// meaning pointers to pages stay valid as new pages are added
+	constexpr static u32 c_blockShift = 8;
+	constexpr static u32 c_pagesPerBlock = 1u << c_blockShift;
+	constexpr static u32 c_blockPageMask = c_pagesPerBlock - 1;
+
+	struct PageBlock
+	{
+		Page m_pages[ c_pagesPerBlock ];
+
+		// one bit per page, set when that page has allocated components
+		u64 m_allocated[ c_pagesPerBlock / 64 ] {};
+	};
+
+	inline Page* GetPage( u32 page_index ) const
+	{
+		const u32 block_index = page_index >> c_blockShift;
+		if ( block_index >= m_directory.size() || !m_directory[ block_index ] )
+			return nullptr;
+
+		Page& page = m_directory[ block_index ]->m_pages[ page_index & c_blockPageMask ];
+		return page.IsAllocated() ? &page : nullptr;
+	}
+
+	// find the first allocated page at or after the given page index
+	Page* FindPage( u32 page_index ) const;
+
+	Page* GetFirstPage() const { return FindPage( 0 ); }
+	Page* GetNextPage( const Page& page ) const { return FindPage( page.GetPageIndex() + 1 ); }
+
+	// entities are also grouped into chunks of 64, regardless of page size
+	// so that tables with different page sizes can be joined a bitmap word at a time
+	constexpr static u32 c_chunkShift = 6;
+	constexpr static u32 c_chunkSize = 1u << c_chunkShift;
+
+	// the occupancy (or dirty) flags for the entities in a chunk, bit n is for entity chunk_index * c_chunkSize + n
+	u64 GetChunkMask( u32 chunk_index, bool dirty ) const;
+
+	// find the first chunk at or after the given one that this table has a page for, UINT32_MAX if there isn't one
+	u32 FindChunk( u32 chunk_index ) const;
+
+	inline u32 GetPageIndex( EntityID entity ) const { return entity.GetIndex() >> m_pageShift; }
+	inline u32 GetIndexInPage( EntityID entity ) const { return entity.GetIndex() & ( ( 1u << m_pageShift ) - 1 ); }
+	inline u32 GetPageID( EntityID entity ) const { return entity.GetIndex() & ~( ( 1u << m_pageShift ) - 1 ); }
+
+	const PagePool& GetPagePool() const { return m_pagePool; }
+
 private:
 	const MetaData& m_metaData;
-	std::vector< Page > m_pages;
+	const u32 m_pageShift;
+	PagePool m_pagePool;
+	std::vector< std::unique_ptr< PageBlock > > m_directory;
 	bool m_hasChanged = false;
 
+	// the indices of entities that have gained or lost this component since the last CleanUpPages
+	std::vector< u32 > m_changeLog;
+
+	inline void LogChange( EntityID entity )
+	{
+		m_hasChanged = true;
+		m_changeLog.push_back( entity.GetIndex() );
+	}
+
+	Page* GetOrAllocatePage( u32 page_index );
+
 public:
-	Page* Begin() { return m_pages.empty() ? nullptr : &m_pages.front(); }
-	Page* End() { return m_pages.empty() ? nullptr : (&m_pages.back() + 1); }
 
 	bool HasChanged() const { return m_hasChanged; }
 	void ResetHasChanged() { m_hasChanged = false; }
+
+	// in the order the changes happened, so it may have duplicates
+	const std::vector< u32 >& GetChangeLog() const { return m_changeLog; }
 };
 
 template< typename Component >
 const GenericComponentTable::MetaData GenericComponentTable::MetaData::s_singleton {
 	typeid( Component ).hash_code(),
+	sizeof( Component ),
+	ComponentPageShift< Component >::c_pageShift,
 	__DestructorCallback< Component >,
 	__CopyComponentToWorld< Component >,
 	__RemoveComponent< Component >,
+	__RemoveComponents< Component >,
 };
 
 template< typename Component >
@@ -442,9 +613,9 @@ struct ComponentTable : GenericComponentTable
 	struct Page : GenericComponentTable::Page
 	{
 		void Clear() { GenericComponentTable::Page::Clear< Component >(); }
-		Component* GetComponent( u8 index ) const { return GenericComponentTable::Page::GetComponent< Component >( index ); }
-		Component& AddComponent( u8 index, Component&& component ) { return GenericComponentTable::Page::AddComponent< Component >( index, std::move( component ) ); }
-		bool RemoveComponent( u8 index ) { return GenericComponentTable::Page::RemoveComponent< Component >( index ); }
+		Component* GetComponent( u32 index ) const { return GenericComponentTable::Page::GetComponent< Component >( index ); }
+		Component& AddComponent( u32 index, Component&& component ) { return GenericComponentTable::Page::AddComponent< Component >( index, std::move( component ) ); }
+		bool RemoveComponent( u32 index ) { return GenericComponentTable::Page::RemoveComponent< Component >( index ); }
 	};
 
 	struct Iterator : GenericComponentTable::Iterator
@@ -6,17 +6,31 @@ namespace onyx::ecs
 
 struct EntityID
 {
+	// the bottom c_indexBits bits of an id are its index into the component tables, the top bits are its generation
+	// so a world can have at most 2^20 - 1 (about a million) entities at once, the last index is kept as an end marker
+	// worlds bump the generation of an index when its entity is removed
+	// so that stale ids can be told apart from the new entity using the same index, if the world recycles it
+	constexpr static u32 c_indexBits = 20;
+	constexpr static u32 c_indexMask = ( 1u << c_indexBits ) - 1;
+	constexpr static u32 c_generationMask = ~0u >> c_indexBits;
+
 	constexpr EntityID( u32 id = 0 ) : id( id ) {}
+	constexpr EntityID( u32 index, u32 generation ) : id( ( index & c_indexMask ) | ( ( generation & c_generationMask ) << c_indexBits ) ) {}
 	constexpr EntityID( const EntityID& other ) : id( other.id ) {}
 	constexpr EntityID( EntityID&& other ) : id( other.id ) {}
 
 	constexpr operator u32() const { return id; }
 	constexpr operator bool() const { return id; }
 
-	bool operator <( const EntityID& other ) const { return id < other.id; }
-	bool operator >( const EntityID& other ) const { return id > other.id; }
-	bool operator <=( const EntityID& other ) const { return id <= other.id; }
-	bool operator >=( const EntityID& other ) const { return id >= other.id; }
+	constexpr u32 GetIndex() const { return id & c_indexMask; }
+	constexpr u32 GetGeneration() const { return id >> c_indexBits; }
+
+	// ids are ordered by index, the same order entities are stored in component tables, then by generation
+	// so that ids that aren't equal are never equivalent either, e.g. as keys in ordered containers
+	bool operator <( const EntityID& other ) const { return GetOrderKey() < other.GetOrderKey(); }
+	bool operator >( const EntityID& other ) const { return GetOrderKey() > other.GetOrderKey(); }
+	bool operator <=( const EntityID& other ) const { return GetOrderKey() <= other.GetOrderKey(); }
+	bool operator >=( const EntityID& other ) const { return GetOrderKey() >= other.GetOrderKey(); }
 	bool operator ==( const EntityID& other ) const { return id == other.id; }
 	bool operator !=( const EntityID& other ) const { return id != other.id; }
 	
@@ -29,6 +43,8 @@ struct EntityID
 
 private:
 	u32 id = 0;
+
+	constexpr u32 GetOrderKey() const { return ( id << ( 32 - c_indexBits ) ) | ( id >> c_indexBits ); }
 };
 
 static constexpr EntityID NoEntity;
@@ -0,0 +1,75 @@
+#include "FrameGraph.h"
+
+#include "tracy/Tracy.hpp"
+
+namespace onyx::ecs
+{
+
+void FrameGraph::AddSystemSet( ISystemSet& system_set )
+{
+	m_systemSets.push_back( &system_set );
+}
+
+void FrameGraph::Run()
+{
+	ZoneScoped;
+
+	WorkerPool& worker_pool = onyx::LowLevel::GetWorkerPool();
+
+	// the graph can't be rebuilt while it's running
+	worker_pool.Wait();
+
+	if ( IsStale() )
+		BuildGraph();
+
+	worker_pool.Begin( m_graph );
+}
+
+bool FrameGraph::IsStale() const
+{
+	if ( m_setRevisions.size() != m_systemSets.size() )
+		return true;
+
+	for ( u32 set_index = 0; set_index < m_systemSets.size(); ++set_index )
+		if ( m_setRevisions[ set_index ] != m_systemSets[ set_index ]->GetRevision() )
+			return true;
+
+	return false;
+}
+
+void FrameGraph::BuildGraph()
+{
+	ZoneScoped;
+
+	m_graph.Reset();
+	m_setRevisions.clear();
+
+	std::vector< IJob* > system_jobs;
+	std::vector< const SystemAccess* > system_access;
+
+	for ( ISystemSet* system_set : m_systemSets )
+	{
+		const u32 first_system = (u32)system_jobs.size();
+
+		for ( u32 system_index = 0; system_index < system_set->GetSystemCount(); ++system_index )
+		{
+			IJob& job = system_set->AddSystemJob( m_graph, system_index );
+			const SystemAccess& access = system_set->GetSystemAccess( system_index );
+
+			// anything in an earlier set that conflicts has to finish first
+			for ( u32 earlier_system = 0; earlier_system < first_system; ++earlier_system )
+				if ( system_access[ earlier_system ]->ConflictsWith( access ) )
+					job.AddDependency( system_jobs[ earlier_system ] );
+
+			system_jobs.push_back( &job );
+			system_access.push_back( &access );
+		}
+
+		for ( const auto [first, second] : system_set->GetDependencies() )
+			system_jobs[ first_system + second ]->AddDependency( system_jobs[ first_system + first ] );
+
+		m_setRevisions.push_back( system_set->GetRevision() );
+	}
+}
+
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "SystemSet.h"
+#include "Onyx/Multithreading.h"
+
+#include <vector>
+
+namespace onyx::ecs
+{
+
+// runs several system sets as one job graph, so a set doesn't have to wait for every system in the sets before it
+// a system only waits for the systems in earlier sets that it conflicts with, and for its own set's dependencies
+// context members are matched by type, so sets that share a context type should be given the same object
+struct FrameGraph
+{
+	// sets run in the order they were added
+	void AddSystemSet( ISystemSet& system_set );
+
+	// each set's context has to be set with SetContext first
+	void Run();
+
+	// the systems' jobs in the order their sets were added, with their timings, see JobGraph::ExportDOT and ExportJSON
+	const JobGraph& GetJobGraph() const { return m_graph; }
+
+private:
+	std::vector< ISystemSet* > m_systemSets;
+
+	// the revision of each set when the graph was built, so it can be rebuilt if one changes
+	std::vector< u32 > m_setRevisions;
+
+	JobGraph m_graph;
+
+	bool IsStale() const;
+	void BuildGraph();
+};
+
+}
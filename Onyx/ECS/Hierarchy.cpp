@@ -0,0 +1,119 @@
+#include "Hierarchy.h"
+
+#include <algorithm>
+
+namespace onyx::ecs
+{
+
+void EntityHierarchy::Attach( u32 child, u32 parent )
+{
+	if ( std::max( child, parent ) >= m_nodes.size() )
+		m_nodes.resize( std::max( child, parent ) + 1 );
+
+	if ( m_nodes[ child ].parent == parent )
+		return;
+
+	Detach( child );
+
+	Node& child_node = m_nodes[ child ];
+	Node& parent_node = m_nodes[ parent ];
+
+	child_node.parent = parent;
+	child_node.previousSibling = parent_node.lastChild;
+
+	if ( parent_node.lastChild != c_none )
+		m_nodes[ parent_node.lastChild ].nextSibling = child;
+	else
+	{
+		parent_node.firstChild = child;
+		AddParent( parent );
+	}
+
+	parent_node.lastChild = child;
+
+	m_attached.push_back( child );
+}
+
+void EntityHierarchy::Detach( u32 child )
+{
+	if ( child >= m_nodes.size() )
+		return;
+
+	Node& child_node = m_nodes[ child ];
+	if ( child_node.parent == c_none )
+		return;
+
+	Node& parent_node = m_nodes[ child_node.parent ];
+
+	if ( child_node.previousSibling != c_none )
+		m_nodes[ child_node.previousSibling ].nextSibling = child_node.nextSibling;
+	else
+		parent_node.firstChild = child_node.nextSibling;
+
+	if ( child_node.nextSibling != c_none )
+		m_nodes[ child_node.nextSibling ].previousSibling = child_node.previousSibling;
+	else
+		parent_node.lastChild = child_node.previousSibling;
+
+	if ( parent_node.firstChild == c_none )
+		RemoveParent( child_node.parent );
+
+	child_node.parent = c_none;
+	child_node.previousSibling = c_none;
+	child_node.nextSibling = c_none;
+}
+
+void EntityHierarchy::Remove( u32 index )
+{
+	if ( index >= m_nodes.size() )
+		return;
+
+	Detach( index );
+
+	if ( m_nodes[ index ].firstChild != c_none )
+		RemoveParent( index );
+
+	// the children keep their AttachedTo, but there's nothing left for it to point at
+	for ( u32 child = m_nodes[ index ].firstChild; child != c_none; )
+	{
+		Node& child_node = m_nodes[ child ];
+		const u32 next_sibling = child_node.nextSibling;
+
+		child_node.parent = c_none;
+		child_node.previousSibling = c_none;
+		child_node.nextSibling = c_none;
+
+		child = next_sibling;
+	}
+
+	m_nodes[ index ].firstChild = c_none;
+	m_nodes[ index ].lastChild = c_none;
+}
+
+void EntityHierarchy::AddParent( u32 index )
+{
+	m_nodes[ index ].parentsIndex = u32( m_parents.size() );
+	m_parents.push_back( index );
+}
+
+void EntityHierarchy::RemoveParent( u32 index )
+{
+	// the last parent takes its place
+	const u32 parents_index = m_nodes[ index ].parentsIndex;
+	m_parents[ parents_index ] = m_parents.back();
+	m_nodes[ m_parents[ parents_index ] ].parentsIndex = parents_index;
+	m_parents.pop_back();
+
+	m_nodes[ index ].parentsIndex = c_none;
+}
+
+bool EntityHierarchy::IsDescendant( u32 index, u32 ancestor ) const
+{
+	for ( u32 parent = GetParent( index ); parent != c_none; parent = GetParent( parent ) )
+		if ( parent == ancestor )
+			return true;
+
+	return false;
+}
+
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <vector>
+
+namespace onyx::ecs
+{
+
+// parent, child and sibling links between entity indices, built from onyx::Core::AttachedTo
+// the world keeps it up to date as attachments are added and removed, see World::UpdateAttachment
+// so finding an entity's children, or walking its whole subtree, only touches the entities involved
+// it doesn't know about generations, the world only links entities to parents that are still alive
+struct EntityHierarchy
+{
+	constexpr static u32 c_none = UINT32_MAX;
+
+	// makes child the last child of parent, moving it from its old parent if it had one
+	void Attach( u32 child, u32 parent );
+	void Detach( u32 child );
+
+	// detaches the entity from its parent, and its children from it
+	void Remove( u32 index );
+
+	void Clear() { m_nodes.clear(); m_attached.clear(); m_parents.clear(); }
+
+	// the entities that have been attached to something new since ClearAttached, the world clears it in CleanUpPages
+	const std::vector< u32 >& GetAttached() const { return m_attached; }
+	void ClearAttached() { m_attached.clear(); }
+
+	// the entities that have at least one child, in no particular order
+	const std::vector< u32 >& GetParents() const { return m_parents; }
+
+	u32 GetParent( u32 index ) const { return index < m_nodes.size() ? m_nodes[ index ].parent : c_none; }
+	u32 GetFirstChild( u32 index ) const { return index < m_nodes.size() ? m_nodes[ index ].firstChild : c_none; }
+	u32 GetNextSibling( u32 index ) const { return index < m_nodes.size() ? m_nodes[ index ].nextSibling : c_none; }
+
+	// true if index is somewhere below ancestor
+	bool IsDescendant( u32 index, u32 ancestor ) const;
+
+	// calls func( index ) for everything below root, parents before their children
+	template< typename Func >
+	void VisitDescendants( u32 root, const Func& func ) const
+	{
+		u32 index = GetFirstChild( root );
+
+		while ( index != c_none )
+		{
+			func( index );
+
+			if ( m_nodes[ index ].firstChild != c_none )
+			{
+				index = m_nodes[ index ].firstChild;
+				continue;
+			}
+
+			// climb back up until there's a sibling to move onto, stopping at the root
+			while ( index != root && m_nodes[ index ].nextSibling == c_none )
+				index = m_nodes[ index ].parent;
+
+			index = index == root ? c_none : m_nodes[ index ].nextSibling;
+		}
+	}
+
+private:
+	struct Node
+	{
+		u32 parent = c_none;
+		u32 firstChild = c_none;
+		u32 lastChild = c_none;
+		u32 previousSibling = c_none;
+		u32 nextSibling = c_none;
+
+		// where the entity is in m_parents, if it has any children
+		u32 parentsIndex = c_none;
+	};
+
+	// indexed by entity index, only as long as the highest index that's been attached to anything
+	std::vector< Node > m_nodes;
+
+	std::vector< u32 > m_attached;
+	std::vector< u32 > m_parents;
+
+	void AddParent( u32 index );
+	void RemoveParent( u32 index );
+};
+
+}
@@ -21,43 +21,92 @@ struct Name
 	std::string name = "";
 };
 
+// 2D affine transforms are kept as the top two rows of a 3x3 matrix, the bottom row is always ( 0, 0, 1 )
+using Affine2D = glm::mat3x2;
+
+inline glm::mat3 AffineToMatrix( const Affine2D& affine )
+{
+	return glm::mat3( glm::vec3( affine[ 0 ], 0.f ), glm::vec3( affine[ 1 ], 0.f ), glm::vec3( affine[ 2 ], 1.f ) );
+}
+
+inline Affine2D MatrixToAffine( const glm::mat3& matrix )
+{
+	return Affine2D( glm::vec2( matrix[ 0 ] ), glm::vec2( matrix[ 1 ] ), glm::vec2( matrix[ 2 ] ) );
+}
+
+inline glm::vec2 TransformPoint( const Affine2D& affine, const glm::vec2& point )
+{
+	return affine[ 0 ] * point.x + affine[ 1 ] * point.y + affine[ 2 ];
+}
+
+inline Affine2D MultiplyAffine( const Affine2D& lhs, const Affine2D& rhs )
+{
+	return Affine2D(
+		lhs[ 0 ] * rhs[ 0 ].x + lhs[ 1 ] * rhs[ 0 ].y,
+		lhs[ 0 ] * rhs[ 1 ].x + lhs[ 1 ] * rhs[ 1 ].y,
+		TransformPoint( lhs, rhs[ 2 ] )
+	);
+}
+
+inline Affine2D InvertAffine( const Affine2D& affine )
+{
+	const f32 inverse_determinant = 1.f / ( affine[ 0 ].x * affine[ 1 ].y - affine[ 1 ].x * affine[ 0 ].y );
+
+	const glm::vec2 column_0 = glm::vec2( affine[ 1 ].y, -affine[ 0 ].y ) * inverse_determinant;
+	const glm::vec2 column_1 = glm::vec2( -affine[ 1 ].x, affine[ 0 ].x ) * inverse_determinant;
+
+	return Affine2D( column_0, column_1, -( column_0 * affine[ 2 ].x + column_1 * affine[ 2 ].y ) );
+}
+
 struct Transform2D
 {
 private:
-	glm::mat3 m_locale = glm::mat3( 1.f );
-	glm::mat3 m_inverseLocale = glm::mat3( 1.f );
+	// the parent's matrix, or the identity for entities that aren't attached to anything
+	Affine2D m_locale = Affine2D( 1.f );
+
+	// m_locale * translate( m_position ) * rotate( m_rotation ) * scale( m_scale ), kept up to date by the setters
+	Affine2D m_matrix = Affine2D( 1.f );
 
 	glm::vec2 m_position {};
 	glm::vec2 m_scale { 1.f, 1.f };
 	f32 m_rotation {};
 
-	glm::mat3 CalculateMatrix() const
-	{
-		glm::mat3 result = m_locale;
+	bool m_moved = true;
 
-		result = glm::translate( result, m_position );
-		result = glm::rotate( result, glm::radians( m_rotation ) );
-		result = glm::scale( result, m_scale );
+	// moving only changes the translation, so there's no need to rotate and scale again
+	void RefreshPosition() { m_matrix[ 2 ] = TransformPoint( m_locale, m_position ); m_moved = true; }
 
-		return result;
-	}
+	void Refresh()
+	{
+		const f32 radians = glm::radians( m_rotation );
+		const glm::vec2 x_axis = glm::vec2( glm::cos( radians ), glm::sin( radians ) );
 
-	glm::mat3 m_matrix = CalculateMatrix();
-	void Refresh() { m_matrix = CalculateMatrix(); }
+		m_matrix = MultiplyAffine( m_locale, Affine2D( x_axis * m_scale.x, glm::vec2( -x_axis.y, x_axis.x ) * m_scale.y, m_position ) );
+		m_moved = true;
+	}
 
 public:
 	Transform2D( const glm::vec2& position = {}, const glm::vec2& scale = { 1, 1 }, f32 rotation = 0 )
 		: m_position( position )
 		, m_scale( scale )
 		, m_rotation( rotation )
-	{}
+	{
+		Refresh();
+	}
 
-	void SetLocale( const glm::mat3& locale ) { m_locale = locale; m_inverseLocale = glm::inverse( m_locale ); Refresh(); }
-	void SetLocalPosition( const glm::vec2& position ) { m_position = position; Refresh(); }
+	void SetLocale( const Affine2D& locale ) { m_locale = locale; Refresh(); }
+	void SetLocale( const glm::mat3& locale ) { SetLocale( MatrixToAffine( locale ) ); }
+	void SetLocalPosition( const glm::vec2& position ) { m_position = position; RefreshPosition(); }
 	void SetLocalScale( const glm::vec2& scale ) { m_scale = scale; Refresh(); }
 	void SetLocalRotation( f32 rotation ) { m_rotation = rotation; Refresh(); }
 
-	const glm::mat3& GetLocale() const { return m_locale; }
+	// for things that move and turn every frame, so the matrix is only rebuilt once
+	void SetLocalPositionAndRotation( const glm::vec2& position, f32 rotation ) { m_position = position; m_rotation = rotation; Refresh(); }
+
+	glm::mat3 GetLocale() const { return AffineToMatrix( m_locale ); }
+	const Affine2D& GetLocaleAffine() const { return m_locale; }
+	bool HasLocale() const { return m_locale != Affine2D( 1.f ); }
+
 	const glm::vec2& GetLocalPosition() const { return m_position; }
 	const glm::vec2& GetLocalScale() const { return m_scale; }
 	const f32& GetLocalRotation() const { return m_rotation; }
@@ -66,11 +115,19 @@ public:
 	glm::vec2 GetWorldScale() const { return glm::vec2( glm::length( m_matrix[ 0 ] ), glm::length( m_matrix[ 1 ] ) ); }
 	f32 GetWorldRotation() const { return atan2( m_matrix[ 0 ].y, m_matrix[ 0 ].x ); }
 
-	glm::vec2 GetRelative( glm::vec3 relative ) const { return m_matrix * relative; }
-	glm::vec2 LocalToWorld( glm::vec2 local ) const { return m_locale * glm::vec3( local, 1.f ); }
-	glm::vec2 WorldToLocal( glm::vec2 local ) const { return m_inverseLocale * glm::vec3( local, 1.f ); }
+	glm::vec2 GetRelative( glm::vec3 relative ) const { return m_matrix[ 0 ] * relative.x + m_matrix[ 1 ] * relative.y + m_matrix[ 2 ] * relative.z; }
+	glm::vec2 LocalToWorld( glm::vec2 local ) const { return TransformPoint( m_locale, local ); }
+
+	// the inverse is only worked out when it's asked for, nothing needs it often enough to be worth keeping
+	glm::vec2 WorldToLocal( glm::vec2 world ) const { return TransformPoint( InvertAffine( m_locale ), world ); }
 
-	const glm::mat3& GetMatrix() const { return m_matrix; }
+	glm::mat3 GetMatrix() const { return AffineToMatrix( m_matrix ); }
+	const Affine2D& GetAffine() const { return m_matrix; }
+
+	// set whenever the matrix changes, UpdateTransform2DLocales uses it to find the subtrees that need updating
+	// and clears it on everything it visits, it only reads parents' flags, so a leaf's is cleared the first time it has children
+	bool HasMoved() const { return m_moved; }
+	void SetMoved( bool moved ) { m_moved = moved; }
 
 	COMPONENT_REFLECTOR_FRIEND( Transform2D );
 };
@@ -80,22 +137,24 @@ struct AttachedTo
 	onyx::ecs::EntityID localeEntity;
 };
 
+// gives attached entities their parent's matrix as their locale, a level of the hierarchy at a time
+// so a whole tree is up to date in one frame, and each level is split between the workers
+// only the subtrees under transforms that have moved, or entities that have just been attached, are visited
 namespace UpdateTransform2DLocales
 {
-using Context = onyx::ecs::Context<>;
+using Context = onyx::ecs::Context< const onyx::ecs::World >;
 
 using Transforms = onyx::ecs::Query<
-	onyx::ecs::Read< Transform2D >
->;
-
-using AttachedTransforms = onyx::ecs::Query<
-	onyx::ecs::Write< Transform2D >,
-	onyx::ecs::Read< AttachedTo >
+	onyx::ecs::Write< Transform2D >
 >;
 
-void System( Context ctx, const Transforms& parents, const AttachedTransforms& children );
+void System( Context ctx, const Transforms& transforms );
 }
 
 void PostCopyUpdateRootTransforms2D( const ecs::World& world, const ecs::IDMap& id_map, const glm::mat3& transform );
 
 }
+
+// transforms are on almost every entity, so give them big pages
+COMPONENT_PAGE_SIZE( onyx::Core::Transform2D, 256 );
+COMPONENT_PAGE_SIZE( onyx::Core::AttachedTo, 64 );
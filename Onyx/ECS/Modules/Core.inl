@@ -7,13 +7,13 @@ namespace onyx::Core
 template< typename SystemSet >
 void Register2DGameplaySystems( SystemSet& system_set )
 {
-	system_set.AddSystem( UpdateTransform2DLocales::System );
+	system_set.AddSystem( UpdateTransform2DLocales::System, "UpdateTransform2DLocales" );
 }
 
 template< typename SystemSet >
 void Register2DEditorSystems( SystemSet& system_set )
 {
-	system_set.AddSystem( UpdateTransform2DLocales::System );
+	system_set.AddSystem( UpdateTransform2DLocales::System, "UpdateTransform2DLocales" );
 }
 
 }
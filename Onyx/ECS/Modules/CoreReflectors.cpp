@@ -16,9 +16,19 @@ COMPONENT_REFLECTOR( AttachedTo )
 		f( AttachedTo, EntityID, localeEntity, "Parent" )\
 
 	DEFAULT_SERIALISE_COMPONENT( AttachedTo, xproperties );
-	DEFAULT_DESERIALISE_COMPONENT( AttachedTo, xproperties );
 	DEFAULT_SERIALISE_COMPONENT_EDITS( AttachedTo, xproperties );
 
+	// attachments are added rather than edited in place, so the world's hierarchy sees them
+	DESERIALISE_COMPONENT()
+	{
+		AttachedTo attachment;
+		if ( const AttachedTo* const existing = world.GetComponent< AttachedTo >( entity ) )
+			attachment = *existing;
+
+		DefaultDeserialiseProperty< EntityID >( reader, asset_manager, attachment.localeEntity, "Parent"_name );
+		world.AddComponent( entity, std::move( attachment ) );
+	}
+
 	DO_COMPONENT_EDITOR_UI()
 	{
 		BEGIN_COMPONENT_EDITOR_UI( AttachedTo, attachment );
@@ -32,7 +42,10 @@ COMPONENT_REFLECTOR( AttachedTo )
 	POST_COPY_TO_WORLD()
 	{
 		BEGIN_POST_COPY_TO_WORLD( AttachedTo, attachment );
-		UpdateEntityID( attachment.localeEntity, entity_id_map );
+
+		AttachedTo remapped = attachment;
+		UpdateEntityID( remapped.localeEntity, entity_id_map );
+		world.AddComponent( entity, std::move( remapped ) );
 	}
 
 	#undef xproperties
@@ -91,4 +104,7 @@ void onyx::Core::RegisterReflectors( onyx::ecs::ComponentReflectorTable& table )
 	REGISTER_COMPONENT_REFLECTOR( table, AttachedTo );
 	REGISTER_COMPONENT_REFLECTOR( table, Name );
 	REGISTER_COMPONENT_REFLECTOR( table, Transform2D );
+
+	// the editor's scene instances aren't reflected, but still need an id before the registry is sealed
+	onyx::ecs::ComponentRegistry::Register< onyx::ecs::SceneInstance >();
 }
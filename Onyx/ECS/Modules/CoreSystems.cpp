@@ -1,23 +1,164 @@
 #include "Core.h"
 
+#include "Onyx/ParallelAlgorithms.h"
+
 #include "tracy/Tracy.hpp"
 
 namespace onyx::Core
 {
 
-void UpdateTransform2DLocales::System( Context ctx, const Transforms& parents, const AttachedTransforms& children )
+// levels smaller than this aren't worth splitting between the workers
+constexpr static u32 c_minTransformsPerChunk = 256;
+
+static u32 GetTransformChunkCount( size_t count )
+{
+	const u32 max_chunks = ( onyx::LowLevel::GetWorkerPool().GetWorkerCount() + 1 ) * 4;
+	return std::clamp( u32( count ) / c_minTransformsPerChunk, 1u, max_chunks );
+}
+
+namespace
+{
+// a transform waiting for its parent's matrix, the parent is already up to date by the time it's reached
+struct QueuedTransform
+{
+	u32 index;
+	Transform2D* transform;
+	const Transform2D* parent;
+};
+}
+
+void UpdateTransform2DLocales::System( Context ctx, const Transforms& transforms )
 {
 	ZoneScoped;
 
-	for ( auto& child : children )
+	const ecs::World& world = ctx.Get< const ecs::World >();
+	const ecs::EntityHierarchy& hierarchy = world.GetHierarchy();
+
+	auto get_transform = [&]( u32 index ) -> Transform2D* {
+		if ( index == ecs::EntityHierarchy::c_none )
+			return nullptr;
+
+		const Transforms::Result* const result = transforms.Get( world.GetEntityAtIndex( index ) );
+		return result ? &result->Get< Transform2D& >() : nullptr;
+	};
+
+	// updates start from parents that have moved, and from anything that's just been attached or given a transform
+	// moving a transform doesn't log it anywhere, so only the hierarchy's parents are checked, a leaf's flag has nothing to start
+	const std::vector< u32 >& parents = hierarchy.GetParents();
+	const u32 parent_count = u32( parents.size() );
+	const u32 scan_chunk_count = GetTransformChunkCount( parent_count );
+	std::vector< std::vector< QueuedTransform > > moved_parents( scan_chunk_count );
+
+	ParallelForChunks( scan_chunk_count, [&]( u32 chunk_index ) {
+		const u32 begin = u32( u64( parent_count ) * chunk_index / scan_chunk_count );
+		const u32 end = u32( u64( parent_count ) * ( chunk_index + 1 ) / scan_chunk_count );
+
+		for ( u32 parents_index = begin; parents_index < end; ++parents_index )
+		{
+			Transform2D* const transform = get_transform( parents[ parents_index ] );
+			if ( transform && transform->HasMoved() )
+				moved_parents[ chunk_index ].push_back( { parents[ parents_index ], transform, nullptr } );
+		}
+	} );
+
+	std::vector< QueuedTransform > starts;
+	for ( const std::vector< QueuedTransform >& chunk : moved_parents )
+		starts.insert( starts.end(), chunk.begin(), chunk.end() );
+
+	std::vector< u32 > new_entities;
+	world.CollectChanges( ecs::ComponentRegistry::GetSet< Transform2D >(), new_entities );
+	new_entities.insert( new_entities.end(), hierarchy.GetAttached().begin(), hierarchy.GetAttached().end() );
+
+	for ( const u32 index : new_entities )
 	{
-		auto [id, child_transform, attachment] = child.Break();
+		if ( hierarchy.GetParent( index ) == ecs::EntityHierarchy::c_none )
+			continue;
 
-		if ( auto* parent = parents.Get( attachment.localeEntity ) )
+		if ( Transform2D* const transform = get_transform( index ) )
 		{
-			auto [id, parent_transform] = parent->Break();
+			transform->SetMoved( true );
+			starts.push_back( { index, transform, nullptr } );
+		}
+	}
+
+	std::sort( starts.begin(), starts.end(), []( const QueuedTransform& lhs, const QueuedTransform& rhs ) { return lhs.index < rhs.index; } );
+	starts.erase( std::unique( starts.begin(), starts.end(), []( const QueuedTransform& lhs, const QueuedTransform& rhs ) { return lhs.index == rhs.index; } ), starts.end() );
+
+	// each level only depends on the ones above it
+	std::vector< std::vector< QueuedTransform > > levels;
+
+	for ( QueuedTransform& start : starts )
+	{
+		start.parent = get_transform( hierarchy.GetParent( start.index ) );
+
+		// anything below a transform that's already starting an update gets updated by it
+		bool covered = false;
+		bool connected = true;
+		u32 depth = 0;
+
+		for ( u32 ancestor = hierarchy.GetParent( start.index ); ancestor != ecs::EntityHierarchy::c_none; ancestor = hierarchy.GetParent( ancestor ) )
+		{
+			++depth;
+
+			if ( !connected )
+				continue;
+
+			// updates don't get past entities without transforms
+			const Transform2D* const ancestor_transform = get_transform( ancestor );
+			connected = ancestor_transform;
+			covered |= ancestor_transform && ancestor_transform->HasMoved();
+		}
+
+		if ( covered )
+			continue;
+
+		if ( depth >= levels.size() )
+			levels.resize( depth + 1 );
+
+		levels[ depth ].push_back( start );
+	}
+
+	std::vector< std::vector< QueuedTransform > > next_level;
+
+	for ( u32 depth = 0; depth < levels.size(); ++depth )
+	{
+		const std::vector< QueuedTransform >& level = levels[ depth ];
+		const u32 level_chunk_count = GetTransformChunkCount( level.size() );
+
+		next_level.resize( level_chunk_count );
+		for ( std::vector< QueuedTransform >& chunk : next_level )
+			chunk.clear();
+
+		// every entity has one parent, so nothing in a level writes to the same transform
+		// and the parents are either in the level above, or haven't moved
+		ParallelForChunks( level_chunk_count, [&]( u32 chunk_index ) {
+			const u32 begin = u32( u64( level.size() ) * chunk_index / level_chunk_count );
+			const u32 end = u32( u64( level.size() ) * ( chunk_index + 1 ) / level_chunk_count );
+
+			for ( u32 level_index = begin; level_index < end; ++level_index )
+			{
+				const auto [index, transform, parent] = level[ level_index ];
+
+				if ( parent && transform->GetLocaleAffine() != parent->GetAffine() )
+					transform->SetLocale( parent->GetAffine() );
+
+				transform->SetMoved( false );
+
+				for ( u32 child = hierarchy.GetFirstChild( index ); child != ecs::EntityHierarchy::c_none; child = hierarchy.GetNextSibling( child ) )
+					if ( Transform2D* const child_transform = get_transform( child ) )
+						next_level[ chunk_index ].push_back( { child, child_transform, transform } );
+			}
+		} );
+
+		for ( const std::vector< QueuedTransform >& chunk : next_level )
+		{
+			if ( chunk.empty() )
+				continue;
+
+			if ( depth + 1 == levels.size() )
+				levels.emplace_back();
 
-			child_transform.SetLocale( parent_transform.GetMatrix() );
+			levels[ depth + 1 ].insert( levels[ depth + 1 ].end(), chunk.begin(), chunk.end() );
 		}
 	}
 }
@@ -66,10 +66,11 @@ namespace CollectSprites
 {
 using Context = ecs::Context< SpriteRenderData >;
 
-using Entities = ecs::Query<
+// each chunk collects into its own SpriteRenderData, which are merged in order
+using Entities = ecs::Chunk< ecs::Query<
 	ecs::Read< Core::Transform2D >,
 	ecs::Write< Sprite >
->;
+> >;
 
 void System( Context ctx, const Entities& entities );
 }
@@ -78,10 +79,10 @@ namespace UpdateAnimatedSprites
 {
 using Context = ecs::Context< const Tick >;
 
-using Entities = ecs::Query<
+using Entities = ecs::Chunk< ecs::Query<
 	ecs::Write< SpriteAnimator >,
 	ecs::Write< Sprite >
->;
+> >;
 
 void System( Context ctx, const Entities& entities );
 }
@@ -102,3 +103,13 @@ void System( Context ctx, const Entities& entities );
 
 }
 
+template<>
+struct onyx::ecs::ContextReduction< onyx::SpriteRenderData >
+{
+	static constexpr bool c_isReducible = true;
+
+	static void Reset( onyx::SpriteRenderData& data );
+
+	// appends the chunk's sprites, with their texture indices remapped into data's textures
+	static void Merge( onyx::SpriteRenderData& data, const onyx::SpriteRenderData& chunk_data );
+};
@@ -26,8 +26,11 @@ void CollectSprites::System( Context ctx, const Entities& entities )
 		if ( is_new )
 			render_data.textures.push_back( texture );
 
+		// the affine's columns, with the bottom row of a 3x3 matrix filled back in
+		const Core::Affine2D& affine = transform.GetAffine();
+
 		render_data.spriteInstances[ sprite.layer ].push_back( {
-			transform.GetMatrix(),
+			glm::mat3x4( glm::vec4( affine[ 0 ], 0.f, 0.f ), glm::vec4( affine[ 1 ], 0.f, 0.f ), glm::vec4( affine[ 2 ], 1.f, 0.f ) ),
 			sprite.offset,
 			sprite.extent,
 			texture_index
@@ -76,7 +79,7 @@ void UpdateParallaxBackgroundLayers::System( Context ctx, const Entities& entiti
 		auto [id, sprite, transform, animator, background] = layer.Break();
 
 		#ifndef NDEBUG
-		LOG_ASSERT_ONCE( transform.GetLocale() == glm::mat3( 1.f ), "A parallax background layer is attached to something, panic!" );
+		LOG_ASSERT_ONCE( !transform.HasLocale(), "A parallax background layer is attached to something, panic!" );
 		#endif
 
 		// align self with the camera
@@ -102,3 +105,46 @@ void UpdateParallaxBackgroundLayers::System( Context ctx, const Entities& entiti
 }
 
 }
+
+void onyx::ecs::ContextReduction< onyx::SpriteRenderData >::Reset( onyx::SpriteRenderData& data )
+{
+	data.textureIndices.clear();
+	data.textures.clear();
+
+	for ( auto& layer : data.spriteInstances )
+		layer.clear();
+}
+
+void onyx::ecs::ContextReduction< onyx::SpriteRenderData >::Merge( onyx::SpriteRenderData& data, const onyx::SpriteRenderData& chunk_data )
+{
+	ZoneScoped;
+
+	// textures are added in the order they're first seen, same as if the sprites had been collected in one go
+	std::vector< u32 > texture_remap;
+	texture_remap.reserve( chunk_data.textures.size() );
+
+	for ( const auto& texture : chunk_data.textures )
+	{
+		const auto& [ iter, is_new ] = data.textureIndices.insert( { texture.get(), (u32)data.textures.size() } );
+		if ( is_new )
+			data.textures.push_back( texture );
+
+		texture_remap.push_back( iter->second );
+	}
+
+	for ( u32 layer = 0; layer < onyx::SpriteRenderData::s_maxLayers; ++layer )
+	{
+		const auto& chunk_instances = chunk_data.spriteInstances[ layer ];
+		if ( chunk_instances.empty() )
+			continue;
+
+		auto& instances = data.spriteInstances[ layer ];
+		instances.reserve( instances.size() + chunk_instances.size() );
+
+		for ( const auto& instance : chunk_instances )
+		{
+			instances.push_back( instance );
+			instances.back().textureIndex = texture_remap[ instance.textureIndex ];
+		}
+	}
+}
@@ -7,6 +7,18 @@
 namespace onyx::ecs
 {
 
+template< typename Job >
+static void RunJobs( WorkerPool& worker_pool, const std::vector< std::unique_ptr< Job > >& jobs )
+{
+	std::vector< IJob* > job_ptrs;
+	job_ptrs.reserve( jobs.size() );
+
+	for ( const std::unique_ptr< Job >& job : jobs )
+		job_ptrs.push_back( job.get() );
+
+	worker_pool.RunAndWait( job_ptrs );
+}
+
 void QuerySet::Update()
 {
 	ZoneScoped;
@@ -17,8 +29,10 @@ void QuerySet::Update()
 	} );
 
 	std::vector< std::shared_ptr< IQuery > > queries_to_run;
-	std::set< size_t > relevant_components;
+	std::vector< ComponentSet > query_components;
+	ComponentSet relevant_components;
 	queries_to_run.reserve( m_queries.size() );
+	query_components.reserve( m_queries.size() );
 
 	// find the queries that need to rerun
 	for ( auto [_hash, _query] : m_queries )
@@ -28,23 +42,98 @@ void QuerySet::Update()
 			if ( query->NeedsRerun() )
 			{
 				query->ResetNeedsRerun();
-				query->CollectComponentTypes( relevant_components );
+				query->CollectComponentTypes( query_components.emplace_back() );
+				relevant_components |= query_components.back();
 				queries_to_run.push_back( query );
 			}
 		}
 	}
 
-	// if any queries need to rerun, run them
+	m_lastUpdateStats = UpdateStats();
+	m_lastUpdateStats.queriesRun = u32( queries_to_run.size() );
+
+	// if any queries need to rerun, show them the entities that gained or lost their components
 	if ( !queries_to_run.empty() )
 	{
 		ZoneScopedN( "Iterate Entities" );
 
-		for ( World::EntityIterator iter = m_world.Iter( &relevant_components, true ); iter; ++iter )
+		m_lastUpdateStats.changesLogged = m_world.CollectChanges( relevant_components, m_changedEntities );
+		m_lastUpdateStats.entitiesConsidered = u32( m_changedEntities.size() );
+
+		WorkerPool& worker_pool = onyx::LowLevel::GetWorkerPool();
+
+		// each range of entities gets a job per query
+		const u32 entity_count = u32( m_changedEntities.size() );
+		const u32 range_count = std::clamp< u32 >( entity_count / c_minEntitiesPerJob, 1, std::max< u32 >( worker_pool.GetWorkerCount(), 1 ) );
+		const bool run_in_parallel = worker_pool.GetWorkerCount() > 0 && entity_count * queries_to_run.size() >= c_minEntitiesPerJob;
+
+		m_lastUpdateStats.rangeCount = range_count;
+		m_lastUpdateStats.ranInParallel = run_in_parallel;
+
+		for ( auto query : queries_to_run )
+			query->BeginChanges( run_in_parallel ? range_count : 1 );
+
+		if ( !run_in_parallel )
 		{
+			for ( World::EntityIterator iter = m_world.Iter( &relevant_components, m_changedEntities ); iter; ++iter )
+			{
+				for ( auto query : queries_to_run )
+					query->Consider( iter, 0 );
+			}
+
 			for ( auto query : queries_to_run )
-				query->Consider( iter );
+				query->ApplyChanges();
+		}
+		else
+		{
+			// the jobs are run with RunAndWait rather than as a graph of their own
+			// so an update neither waits for a frame graph that's in flight, nor takes the pool's job queue out from under it
+			{
+				ZoneScopedN( "Consider Entities" );
+
+				std::vector< std::unique_ptr< ConsiderRangeJob > > consider_jobs;
+				consider_jobs.reserve( queries_to_run.size() * range_count );
+
+				for ( u32 query_index = 0; query_index < queries_to_run.size(); ++query_index )
+				{
+					for ( u32 range = 0; range < range_count; ++range )
+					{
+						const u32 range_begin = u32( u64( entity_count ) * range / range_count );
+						const u32 range_end = u32( u64( entity_count ) * ( range + 1 ) / range_count );
+						std::span< const u32 > entity_indices = std::span< const u32 >( m_changedEntities ).subspan( range_begin, range_end - range_begin );
+
+						consider_jobs.push_back( std::make_unique< ConsiderRangeJob >( m_world, *queries_to_run[ query_index ], query_components[ query_index ], entity_indices, range ) );
+					}
+				}
+
+				RunJobs( worker_pool, consider_jobs );
+			}
+
+			// the ranges are merged back in order, so the results don't depend on how the work was split up
+			{
+				ZoneScopedN( "Apply Changes" );
+
+				std::vector< std::unique_ptr< ApplyChangesJob > > apply_jobs;
+				apply_jobs.reserve( queries_to_run.size() );
+
+				for ( auto query : queries_to_run )
+					apply_jobs.push_back( std::make_unique< ApplyChangesJob >( *query ) );
+
+				RunJobs( worker_pool, apply_jobs );
+			}
 		}
 	}
+
+	TracyPlot( "Query Changes Logged", i64( m_lastUpdateStats.changesLogged ) );
+	TracyPlot( "Query Entities Considered", i64( m_lastUpdateStats.entitiesConsidered ) );
+}
+
+void QuerySet::ConsiderRangeJob::Run()
+{
+	ZoneScoped;
+
+	for ( World::EntityIterator iter = m_world.Iter( &m_components, m_entityIndices ); iter; ++iter )
+		m_query.Consider( iter, m_range );
 }
 
 }
@@ -1,17 +1,24 @@
 #pragma once
 
 #include "World.h"
+#include "Onyx/Multithreading.h"
 
 #include <set>
+#include <span>
 
 namespace onyx::ecs
 {
 
 struct IQuery
 {
-	virtual void Consider( const World::EntityIterator& entity ) = 0;
-	virtual void OnComponentAddedOrRemoved( size_t component_type_hash ) = 0;
-	virtual void CollectComponentTypes( std::set< size_t >& component_set ) = 0;
+	// the entities in an update are split into ranges which may be considered in parallel, each in order
+	// the changes are held until ApplyChanges, which merges the ranges back together in order
+	virtual void BeginChanges( u32 range_count ) = 0;
+	virtual void Consider( const World::EntityIterator& entity, u32 range ) = 0;
+	virtual void ApplyChanges() = 0;
+
+	virtual void OnComponentsAddedOrRemoved( const ComponentSet& components ) = 0;
+	virtual void CollectComponentTypes( ComponentSet& component_set ) = 0;
 
 	bool NeedsRerun() const { return m_needsRerun; }
 	void ResetNeedsRerun() { m_needsRerun = false; }
@@ -29,7 +36,9 @@ struct Read
 	using Type = T;
 	using Ptr = T*;
 	using Arg = const T&;
+	using Array = const T*;
 	static constexpr bool c_isRequired = true;
+	static constexpr bool c_isWrite = false;
 
 	static Arg Cast( Ptr ptr ) { return *ptr; }
 };
@@ -40,7 +49,9 @@ struct Write
 	using Type = T;
 	using Ptr = T*;
 	using Arg = T&;
+	using Array = T*;
 	static constexpr bool c_isRequired = true;
+	static constexpr bool c_isWrite = true;
 
 	static Arg Cast( Ptr ptr ) { return *ptr; }
 };
@@ -51,7 +62,9 @@ struct ReadOptional
 	using Type = T;
 	using Ptr = T*;
 	using Arg = const T*;
+	using Array = const T*;
 	static constexpr bool c_isRequired = false;
+	static constexpr bool c_isWrite = false;
 
 	static Arg Cast( Ptr ptr ) { return ptr; }
 };
@@ -62,7 +75,9 @@ struct WriteOptional
 	using Type = T;
 	using Ptr = T*;
 	using Arg = T*;
+	using Array = T*;
 	static constexpr bool c_isRequired = false;
+	static constexpr bool c_isWrite = true;
 
 	static Arg Cast( Ptr ptr ) { return ptr; }
 };
@@ -72,6 +87,29 @@ template< typename T > struct ComponentType<       T& > { using Type = Write< T
 template< typename T > struct ComponentType< const T* > { using Type = ReadOptional< T >; };
 template< typename T > struct ComponentType<       T* > { using Type = WriteOptional< T >; };
 
+// context members that lock internally, so systems can share them without being ordered against each other
+template< typename T >
+struct IsThreadSafeContext
+{
+	static constexpr bool c_value = false;
+};
+
+#define THREAD_SAFE_CONTEXT( Type )\
+	template<> struct onyx::ecs::IsThreadSafeContext< Type >\
+	{\
+		static constexpr bool c_value = true;\
+	}
+
+// how a context member is split between the chunks of a system that runs in parallel, see Chunk
+// specialisations need Reset, to get a chunk's own copy ready, and Merge, to add it to the real one
+// copies are reset again once they've been merged, so Reset should let go of anything they hold, but can keep their memory
+// chunks are merged in order, so the result doesn't depend on how the chunks were scheduled
+template< typename T >
+struct ContextReduction
+{
+	static constexpr bool c_isReducible = false;
+};
+
 template< typename ... Components >
 struct Context
 {
@@ -95,10 +133,28 @@ struct Context
 
 	std::tuple< Components& ... > Break() const { return m_components; }
 
+	// members are told apart by type, const members are only read
+	static void CollectAccess( std::vector< size_t >& used_types, std::vector< size_t >& written_types )
+	{
+		( CollectMemberAccess< Components >( used_types, written_types ), ... );
+	}
+
 private:
 	template< typename ... OtherComponents >
 	friend struct Context;
 
+	template< typename T >
+	static void CollectMemberAccess( std::vector< size_t >& used_types, std::vector< size_t >& written_types )
+	{
+		using Type = std::remove_const_t< T >;
+		if constexpr ( !IsThreadSafeContext< Type >::c_value )
+		{
+			used_types.push_back( typeid( Type ).hash_code() );
+			if constexpr ( !std::is_const_v< T > )
+				written_types.push_back( typeid( Type ).hash_code() );
+		}
+	}
+
 	template< typename T > static constexpr bool s_hasComponent = ( std::is_same_v< T, Components > || ... );
 
 	template< bool b, typename T1, typename T2 > struct ChooseType;
@@ -151,14 +207,12 @@ struct Query : IQuery
 
 	const Result* Get( EntityID entity ) const
 	{
-		auto iter = std::lower_bound( begin(), end(), entity, []( const Result& result, EntityID entity ) {
-			return result.GetEntityID() < entity;
-		} );
-
-		if ( iter == end() || iter->GetEntityID() != entity )
+		const u32 entity_index = entity.GetIndex();
+		if ( entity_index >= m_resultSlots.size() || !m_resultSlots[ entity_index ] )
 			return nullptr;
 
-		return &*iter;
+		const Result& result = m_results[ m_resultSlots[ entity_index ] - 1 ];
+		return result.GetEntityID() == entity ? &result : nullptr;
 	}
 
 	u32 Count() const { return static_cast< u32 >( m_results.size() ); }
@@ -167,44 +221,363 @@ struct Query : IQuery
 	std::vector< Result >::const_iterator begin() const { return m_results.cbegin(); }
 	std::vector< Result >::const_iterator end() const { return m_results.cend(); }
 
-	void Consider( const World::EntityIterator& entity ) override
+	void BeginChanges( u32 range_count ) override
 	{
-		const Result result = Result( entity );
+		m_changes.resize( range_count );
+		for ( std::vector< Result >& range_changes : m_changes )
+			range_changes.clear();
+	}
 
-		auto iter = std::lower_bound( m_results.begin(), m_results.end(), entity.GetEntityID(), [](const Result& result, EntityID entity) {
-			return result.GetEntityID() < entity;
-		} );
+	// changes are batched up and merged in one go by ApplyChanges
+	void Consider( const World::EntityIterator& entity, u32 range ) override
+	{
+		std::vector< Result >& range_changes = m_changes[ range ];
+
+#		if _DEBUG
+		STRONG_ASSERT( range_changes.empty() || range_changes.back().GetEntityID() < entity.GetEntityID(), "Entities must be considered in order" );
+#		endif
 
-		const bool iter_matches = iter != end() && iter->GetEntityID() == entity.GetEntityID();
-		
-		if ( result )
+		range_changes.push_back( Result( entity ) );
+	}
+
+	void ApplyChanges() override
+	{
+		size_t change_count = 0;
+		const Result* first_change = nullptr;
+		for ( const std::vector< Result >& range_changes : m_changes )
 		{
-			if ( iter_matches )
-				*iter = result;
-			else
-				m_results.insert( iter, result );
+			if ( !first_change && !range_changes.empty() )
+				first_change = &range_changes.front();
+
+			change_count += range_changes.size();
 		}
-		else
+
+		if ( !first_change )
+			return;
+
+		ZoneScoped;
+
+		m_merged.clear();
+		m_merged.reserve( m_results.size() + change_count );
+
+		auto old_result = m_results.cbegin();
+		for ( const std::vector< Result >& range_changes : m_changes )
 		{
-			if ( iter_matches )
-				m_results.erase( iter );
+			for ( const Result& change : range_changes )
+			{
+				const u32 entity_index = change.GetEntityID().GetIndex();
+
+				while ( old_result != m_results.cend() && old_result->GetEntityID().GetIndex() < entity_index )
+					m_merged.push_back( *old_result++ );
+
+				// match on index, a stale result for a recycled index should be replaced or removed
+				if ( old_result != m_results.cend() && old_result->GetEntityID().GetIndex() == entity_index )
+				{
+					m_resultSlots[ entity_index ] = 0;
+					++old_result;
+				}
+
+				if ( change )
+					m_merged.push_back( change );
+			}
 		}
+
+		// nothing before the first change has moved, so only the slots after it need updating
+		const size_t first_moved = std::lower_bound( m_merged.cbegin(), m_merged.cend(), first_change->GetEntityID(), []( const Result& result, EntityID entity ) {
+			return result.GetEntityID() < entity;
+		} ) - m_merged.cbegin();
+
+		m_merged.insert( m_merged.end(), old_result, m_results.cend() );
+		std::swap( m_results, m_merged );
+
+		for ( std::vector< Result >& range_changes : m_changes )
+			range_changes.clear();
+
+		if ( !m_results.empty() && m_resultSlots.size() <= m_results.back().GetEntityID().GetIndex() )
+			m_resultSlots.resize( m_results.back().GetEntityID().GetIndex() + 1, 0 );
+
+		for ( size_t index = first_moved; index < m_results.size(); ++index )
+			m_resultSlots[ m_results[ index ].GetEntityID().GetIndex() ] = u32( index + 1 );
+	}
+
+	void OnComponentsAddedOrRemoved( const ComponentSet& components ) override
+	{
+		m_needsRerun |= ( components & GetComponentSet() ).any();
 	}
 
-	void OnComponentAddedOrRemoved( size_t component_type_hash ) override
+	void CollectComponentTypes( ComponentSet& component_set ) override
 	{
-		m_needsRerun |= ( ( component_type_hash == typeid( typename Components::Type ).hash_code() ) || ... );
+		component_set |= GetComponentSet();
 	}
 
-	void CollectComponentTypes( std::set< size_t >& component_set ) override
+	static const ComponentSet& GetComponentSet()
 	{
-		component_set.insert( { typeid( typename Components::Type ).hash_code() ... } );
+		static const ComponentSet s_componentSet = ComponentRegistry::GetSet< typename Components::Type ... >();
+		return s_componentSet;
+	}
+
+	static const ComponentSet& GetWrittenComponentSet()
+	{
+		static const ComponentSet s_writtenSet = ( ComponentSet() | ... | ( Components::c_isWrite ? ComponentRegistry::GetSet< typename Components::Type >() : ComponentSet() ) );
+		return s_writtenSet;
 	}
 
 private:
 	std::vector< Result > m_results;
+
+	// one more than the index into m_results for each entity index, 0 if the entity isn't in the results
+	std::vector< u32 > m_resultSlots;
+
+	// the results of Consider for each range, waiting to be merged into m_results
+	std::vector< std::vector< Result > > m_changes;
+
+	// kept around to merge into, so that the memory can be reused
+	std::vector< Result > m_merged;
 };
 
+// like Query, but hands out spans of neighbouring entities instead of one result per entity
+// each span has a contiguous array per component, and a mask of which entities in the span match the query
+// spans never cross a page in any of the component tables, so systems can run tight loops over the arrays
+template< typename ... Components >
+struct SpanQuery : IQuery
+{
+	// limited to 64 so the masks fit in a word, and to the smallest page so the arrays are contiguous
+	constexpr static u32 c_spanShift = std::min( { 6u, ComponentPageShift< typename Components::Type >::c_pageShift ... } );
+	constexpr static u32 c_spanSize = 1u << c_spanShift;
+	constexpr static u64 c_fullMask = ~0ull >> ( 64 - c_spanSize );
+
+	struct Span
+	{
+		using Query = SpanQuery;
+
+		Span( u32 first_index ) : m_firstIndex( first_index ) {}
+
+		// bit n is set if the entity at index n in the span has all of the required components
+		u64 GetMask() const { return m_mask; }
+
+		// every entity in the span matches, so the arrays can be walked without checking the mask
+		bool IsFull() const { return m_mask == c_fullMask; }
+
+		u32 Count() const { return std::popcount( m_mask ); }
+
+		EntityID GetEntityID( u32 index ) const { return m_entities[ index ]; }
+
+		// the array of the given component for this span, indexed the same as the mask
+		template< typename T >
+		auto Get() const
+		{
+			using Component = std::tuple_element_t< IndexOf< T >(), std::tuple< Components ... > >;
+			return typename Component::Array( std::get< IndexOf< T >() >( m_arrays ) );
+		}
+
+		// needed for optional components, required ones are always there for entities in the mask
+		template< typename T >
+		bool Has( u32 index ) const { return m_componentMasks[ IndexOf< T >() ] & ( 1ull << index ); }
+
+		std::tuple< u64, const EntityID*, typename Components::Array ... > Break() const
+		{
+			return { m_mask, m_entities, typename Components::Array( std::get< typename Components::Ptr >( m_arrays ) ) ... };
+		}
+
+	private:
+		friend SpanQuery;
+
+		template< typename T >
+		static constexpr size_t IndexOf()
+		{
+			constexpr bool matches[] = { std::is_same_v< T, typename Components::Type > ... };
+			for ( size_t index = 0; index < sizeof...( Components ); ++index )
+				if ( matches[ index ] )
+					return index;
+
+			return sizeof...( Components );
+		}
+
+		u32 m_firstIndex = 0;
+		u64 m_mask = 0;
+		std::array< u64, sizeof...( Components ) > m_componentMasks {};
+		std::tuple< typename Components::Ptr ... > m_arrays {};
+		EntityID m_entities[ c_spanSize ] {};
+	};
+
+	u32 Count() const { return static_cast< u32 >( m_spans.size() ); }
+	const Span& operator []( u32 index ) const { return m_spans[ index ]; }
+
+	std::vector< Span >::const_iterator begin() const { return m_spans.cbegin(); }
+	std::vector< Span >::const_iterator end() const { return m_spans.cend(); }
+
+	void BeginChanges( u32 range_count ) override
+	{
+		m_changes.resize( range_count );
+		for ( std::vector< Change >& range_changes : m_changes )
+			range_changes.clear();
+	}
+
+	void Consider( const World::EntityIterator& entity, u32 range ) override
+	{
+		std::vector< Change >& range_changes = m_changes[ range ];
+
+#		if _DEBUG
+		STRONG_ASSERT( range_changes.empty() || range_changes.back().m_entity < entity.GetEntityID(), "Entities must be considered in order" );
+#		endif
+
+		range_changes.push_back( { entity.GetEntityID(), { entity.Get< typename Components::Type >() ... } } );
+	}
+
+	// like Query, the changes are merged in one pass, from the first span they touch
+	void ApplyChanges() override
+	{
+		const Change* first_change = nullptr;
+		for ( const std::vector< Change >& range_changes : m_changes )
+		{
+			if ( !range_changes.empty() )
+			{
+				first_change = &range_changes.front();
+				break;
+			}
+		}
+
+		if ( !first_change )
+			return;
+
+		ZoneScoped;
+
+		// nothing before the first change's span is touched
+		const auto first_moved = std::lower_bound( m_spans.begin(), m_spans.end(), first_change->m_entity.GetIndex() & ~( c_spanSize - 1 ), []( const Span& span, u32 first_index ) {
+			return span.m_firstIndex < first_index;
+		} );
+
+		m_merged.clear();
+
+		auto old_span = first_moved;
+
+		for ( std::vector< Change >& range_changes : m_changes )
+		{
+			for ( const Change& change : range_changes )
+			{
+				const u32 first_index = change.m_entity.GetIndex() & ~( c_spanSize - 1 );
+
+				if ( m_merged.empty() || m_merged.back().m_firstIndex != first_index )
+				{
+					// entities that aren't complete will be considered again when they gain the components they're missing
+					if ( !m_merged.empty() && !m_merged.back().m_mask )
+						m_merged.pop_back();
+
+					while ( old_span != m_spans.end() && old_span->m_firstIndex < first_index )
+						m_merged.push_back( std::move( *old_span++ ) );
+
+					if ( old_span != m_spans.end() && old_span->m_firstIndex == first_index )
+						m_merged.push_back( std::move( *old_span++ ) );
+					else if ( change.IsComplete() )
+						m_merged.push_back( Span( first_index ) );
+					else
+						continue;
+				}
+
+				ApplyChange( m_merged.back(), change );
+			}
+
+			range_changes.clear();
+		}
+
+		if ( !m_merged.empty() && !m_merged.back().m_mask )
+			m_merged.pop_back();
+
+		m_merged.insert( m_merged.end(), std::make_move_iterator( old_span ), std::make_move_iterator( m_spans.end() ) );
+
+		m_spans.erase( first_moved, m_spans.end() );
+		m_spans.insert( m_spans.end(), std::make_move_iterator( m_merged.begin() ), std::make_move_iterator( m_merged.end() ) );
+	}
+
+	void OnComponentsAddedOrRemoved( const ComponentSet& components ) override
+	{
+		m_needsRerun |= ( components & GetComponentSet() ).any();
+	}
+
+	void CollectComponentTypes( ComponentSet& component_set ) override
+	{
+		component_set |= GetComponentSet();
+	}
+
+	static const ComponentSet& GetComponentSet()
+	{
+		static const ComponentSet s_componentSet = ComponentRegistry::GetSet< typename Components::Type ... >();
+		return s_componentSet;
+	}
+
+	static const ComponentSet& GetWrittenComponentSet()
+	{
+		static const ComponentSet s_writtenSet = ( ComponentSet() | ... | ( Components::c_isWrite ? ComponentRegistry::GetSet< typename Components::Type >() : ComponentSet() ) );
+		return s_writtenSet;
+	}
+
+private:
+	std::vector< Span > m_spans;
+
+	struct Change
+	{
+		EntityID m_entity;
+		std::tuple< typename Components::Ptr ... > m_components;
+
+		bool IsComplete() const { return ( ( !Components::c_isRequired || std::get< typename Components::Ptr >( m_components ) ) && ... ); }
+	};
+
+	// the results of Consider for each range, waiting to be applied to m_spans
+	std::vector< std::vector< Change > > m_changes;
+
+	// kept around to merge into, so that the memory can be reused
+	std::vector< Span > m_merged;
+
+	static void ApplyChange( Span& span, const Change& change )
+	{
+		const u32 index = change.m_entity.GetIndex() & ( c_spanSize - 1 );
+		const u64 bit = 1ull << index;
+
+		[ & ]< size_t ... Indices >( std::index_sequence< Indices ... > )
+		{
+			// every entity in the span shares the same page, so the start of the array is just behind this entity's component
+			( ( std::get< Indices >( change.m_components )
+				? ( std::get< Indices >( span.m_arrays ) = std::get< Indices >( change.m_components ) - index, span.m_componentMasks[ Indices ] |= bit )
+				: span.m_componentMasks[ Indices ] &= ~bit ), ... );
+		}( std::index_sequence_for< Components ... >() );
+
+		span.m_entities[ index ] = change.m_entity;
+		span.m_mask = change.IsComplete() ? span.m_mask | bit : span.m_mask & ~bit;
+	}
+};
+
+// a run of a query's results, systems that take a chunk instead of the query are split up and run in parallel
+// each chunk gets at least MinCount results, so chunks aren't so small that scheduling them costs more than they save
+template< typename Query, u32 MinCount = 256 >
+struct Chunk
+{
+	using QueryType = Query;
+	constexpr static u32 c_minCount = MinCount;
+
+	Chunk( const Query& query, u32 begin, u32 end )
+		: m_query( query )
+		, m_begin( begin )
+		, m_end( end )
+	{}
+
+	u32 Count() const { return m_end - m_begin; }
+	const auto& operator []( u32 index ) const { return m_query[ m_begin + index ]; }
+
+	auto begin() const { return m_query.begin() + m_begin; }
+	auto end() const { return m_query.begin() + m_end; }
+
+	// the whole query, for looking up entities outside of the chunk
+	const Query& GetQuery() const { return m_query; }
+
+private:
+	const Query& m_query;
+	u32 m_begin;
+	u32 m_end;
+};
+
+template< typename T > struct IsChunk { static constexpr bool c_value = false; };
+template< typename Query, u32 MinCount > struct IsChunk< Chunk< Query, MinCount > > { static constexpr bool c_value = true; };
+
 struct QuerySet
 {
 	QuerySet( World& world ) : m_world( world ) {}
@@ -227,10 +600,58 @@ struct QuerySet
 
 	void Update();
 
+	struct UpdateStats
+	{
+		u32 queriesRun = 0;
+		u32 changesLogged = 0;
+		u32 entitiesConsidered = 0;
+		u32 rangeCount = 0;
+		bool ranInParallel = false;
+	};
+
+	const UpdateStats& GetLastUpdateStats() const { return m_lastUpdateStats; }
+
 private:
+	// below this many entities, a job costs more than it saves
+	constexpr static u32 c_minEntitiesPerJob = 512;
+
+	struct ConsiderRangeJob : IJob
+	{
+		ConsiderRangeJob( World& world, IQuery& query, const ComponentSet& components, std::span< const u32 > entity_indices, u32 range )
+			: m_world( world )
+			, m_query( query )
+			, m_components( components )
+			, m_entityIndices( entity_indices )
+			, m_range( range )
+		{}
+
+		void Run() override;
+
+	private:
+		World& m_world;
+		IQuery& m_query;
+		const ComponentSet m_components;
+		const std::span< const u32 > m_entityIndices;
+		const u32 m_range;
+	};
+
+	struct ApplyChangesJob : IJob
+	{
+		ApplyChangesJob( IQuery& query ) : m_query( query ) {}
+
+		void Run() override { m_query.ApplyChanges(); }
+
+	private:
+		IQuery& m_query;
+	};
 
 	World& m_world;
 	std::map< size_t, std::weak_ptr< IQuery > > m_queries;
+
+	// kept around between updates so that the memory can be reused
+	std::vector< u32 > m_changedEntities;
+
+	UpdateStats m_lastUpdateStats;
 };
 
 }
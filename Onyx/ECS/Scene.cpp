@@ -143,13 +143,9 @@ DEFINE_DEFAULT_PROPERTY_EDITOR_UI( std::shared_ptr< Scene > )
 	return was_edited;
 }
 
-const IComponentReflector* ComponentReflectorTable::GetReflector( size_t component_type_hash ) const
+const IComponentReflector* ComponentReflectorTable::GetReflectorByID( ComponentID component_id ) const
 {
-	const auto iter = m_typeHashLookup.find( component_type_hash );
-	if ( iter == m_typeHashLookup.end() )
-		return nullptr;
-
-	return iter->second;
+	return component_id < m_componentIDLookup.size() ? m_componentIDLookup[ component_id ] : nullptr;
 }
 
 const IComponentReflector* ComponentReflectorTable::GetReflector( BjSON::NameHash component_name_hash ) const
@@ -161,9 +157,12 @@ const IComponentReflector* ComponentReflectorTable::GetReflector( BjSON::NameHas
 	return iter->second;
 }
 
-void ComponentReflectorTable::RegisterReflector( const IComponentReflector& reflector, BjSON::NameHash component_name_hash, size_t component_type_hash )
+void ComponentReflectorTable::RegisterReflector( const IComponentReflector& reflector, BjSON::NameHash component_name_hash, ComponentID component_id )
 {
-	m_typeHashLookup.insert( { component_type_hash, &reflector } );
+	if ( component_id >= m_componentIDLookup.size() )
+		m_componentIDLookup.resize( component_id + 1, nullptr );
+
+	m_componentIDLookup[ component_id ] = &reflector;
 	m_typeNameLookup.insert( { component_name_hash, &reflector } );
 	m_reflectors.push_back( &reflector );
 
@@ -392,9 +391,9 @@ void Scene::Save( BjSON::IReadWriteObject& writer, SaveType type )
 		}
 		else
 		{
-			for ( auto& iter : entity_iter.m_iterators )
-				if ( iter.second.GetEntityID() == entity_iter.GetEntityID() )
-					if ( auto reflector = ComponentReflectorTable::s_singleton.GetReflector( iter.first ) )
+			for ( const auto& table : entity_iter.m_tables )
+				if ( table.HasComponent( entity_iter.m_currentEntity ) )
+					if ( auto reflector = ComponentReflectorTable::s_singleton.GetReflectorByID( table.m_componentID ) )
 						reflector->SerialiseComponent( entity_writer, entity_iter );
 
 			++entity_iter;
@@ -19,7 +19,9 @@ struct Scene : IAsset
 	void Save( BjSON::IReadWriteObject& writer, SaveType type ) override;
 	void DoAssetManagerButton( const char* name, const char* path, f32 width, std::shared_ptr< IAsset > asset, IFrameContext& frame_context ) override;
 
-	World m_world;
+	// scenes are saved with their entity ids, and scene instances are saved assuming their entities are contiguous
+	// so ids must not be recycled
+	World m_world { false };
 };
 
 struct SceneEditor : editor::IWindow
@@ -198,6 +200,6 @@ Data types:
 			- Displaying editor ui for a component
 			- Serialising a diff of two components
 		- Need to be able to look up these functions by
-			- BjSON::NameHash and typeid( ... ).hash_code()
+			- BjSON::NameHash and ComponentID
 
 */
@@ -4,37 +4,67 @@
 #include "World.h"
 #include "CommandBuffer.h"
 
+#include <algorithm>
 #include <tuple>
 #include <memory>
+#include <vector>
 
 namespace onyx::ecs
 {
 
+// what a system touches, worked out from the types in its signature
+struct SystemAccess
+{
+	ComponentSet components;
+	ComponentSet writtenComponents;
+
+	// context members, by type hash
+	std::vector< size_t > contextTypes;
+	std::vector< size_t > writtenContextTypes;
+
+	// systems conflict if either one writes something the other uses
+	bool ConflictsWith( const SystemAccess& other ) const
+	{
+		if ( ( writtenComponents & other.components ).any() || ( components & other.writtenComponents ).any() )
+			return true;
+
+		auto overlaps = []( const std::vector< size_t >& a, const std::vector< size_t >& b ) {
+			return std::find_first_of( a.cbegin(), a.cend(), b.cbegin(), b.cend() ) != a.cend();
+		};
+
+		return overlaps( writtenContextTypes, other.contextTypes ) || overlaps( contextTypes, other.writtenContextTypes );
+	}
+};
+
 template< typename IContext >
 struct ISystem
 {
-	ISystem( u64 id ) : id( id ) {}
+	ISystem( u64 id, SystemAccess access ) : id( id ), access( std::move( access ) ) {}
 
 	virtual ~ISystem() = default;
 
 	virtual void Run( const IContext& context ) const = 0;
 
 	u64 GetID() const { return id; }
+	const SystemAccess& GetAccess() const { return access; }
 
 private:
 	u64 id = 0;
+	SystemAccess access;
 };
 
 template< typename IContext, typename Func >
 struct System;
 
+// chunks can only be the first query, see below
 template< typename IContext, typename Context, typename ... Queries >
+	requires ( !IsChunk< Queries >::c_value && ... )
 struct System< IContext, void( Context, const Queries& ... ) > : ISystem< IContext >
 {
 	using Func = void( Context, const Queries& ... );
 
 	System( QuerySet& query_set, Func* callback )
-		: ISystem< IContext >( (u64)callback )
+		: ISystem< IContext >( (u64)callback, CollectAccess() )
 		, m_callback( callback )
 		, m_queries( query_set.Get< Queries >() ... )
 	{}
@@ -45,8 +75,169 @@ struct System< IContext, void( Context, const Queries& ... ) > : ISystem< IConte
 	}
 
 private:
+	static SystemAccess CollectAccess()
+	{
+		SystemAccess access;
+		access.components = ( ComponentSet() | ... | Queries::GetComponentSet() );
+		access.writtenComponents = ( ComponentSet() | ... | Queries::GetWrittenComponentSet() );
+		Context::CollectAccess( access.contextTypes, access.writtenContextTypes );
+		return access;
+	}
+
 	Func* const m_callback;
 	std::tuple< std::shared_ptr< Queries > ... > m_queries;
 };
 
+// the copies of a system's context members that each of its chunks needs, see Chunk
+// members that the chunks write have to be thread safe, or have a ContextReduction so each chunk can have its own copy
+template< typename Context >
+struct ChunkContext;
+
+template< typename ... Components >
+struct ChunkContext< Context< Components ... > >
+{
+	using SystemContext = Context< Components ... >;
+
+	// makes a context that uses the chunk's copies in place of the system's members
+	SystemContext MakeContext( const SystemContext& context ) { return SystemContext( GetMember< Components >( context ) ... ); }
+
+	void Reset() { ( ResetMember< Components >(), ... ); }
+
+	void MergeInto( const SystemContext& context ) const { ( MergeMember< Components >( context ), ... ); }
+
+private:
+	template< typename T >
+	static constexpr bool c_isCopied = !std::is_const_v< T > && !IsThreadSafeContext< T >::c_value;
+
+	static_assert( ( ( !c_isCopied< Components > || ContextReduction< Components >::c_isReducible ) && ... ),
+		"Systems that run in chunks can only write context members that are thread safe or have a ContextReduction" );
+
+	// stands in for members that the chunks share
+	template< typename T >
+	struct Shared {};
+
+	std::tuple< std::conditional_t< c_isCopied< Components >, Components, Shared< Components > > ... > m_members;
+
+	template< typename T >
+	T& GetMember( const SystemContext& context )
+	{
+		if constexpr ( c_isCopied< T > )
+			return std::get< T >( m_members );
+		else
+			return context.template Get< T >();
+	}
+
+	template< typename T >
+	void ResetMember()
+	{
+		if constexpr ( c_isCopied< T > )
+			ContextReduction< T >::Reset( std::get< T >( m_members ) );
+	}
+
+	template< typename T >
+	void MergeMember( const SystemContext& context ) const
+	{
+		if constexpr ( c_isCopied< T > )
+			ContextReduction< T >::Merge( context.template Get< T >(), std::get< T >( m_members ) );
+	}
+};
+
+// systems that take a Chunk as their first query run once per chunk, with the chunks spread across the workers
+// chunks are merged back in order, so the results are the same as running the whole query in one go
+template< typename IContext, typename Context, typename ChunkedQuery, u32 MinCount, typename ... Queries >
+struct System< IContext, void( Context, const Chunk< ChunkedQuery, MinCount >&, const Queries& ... ) > : ISystem< IContext >
+{
+	using SystemChunk = Chunk< ChunkedQuery, MinCount >;
+	using Func = void( Context, const SystemChunk&, const Queries& ... );
+
+	System( QuerySet& query_set, Func* callback )
+		: ISystem< IContext >( (u64)callback, CollectAccess() )
+		, m_callback( callback )
+		, m_chunkedQuery( query_set.Get< ChunkedQuery >() )
+		, m_queries( query_set.Get< Queries >() ... )
+	{}
+
+	void Run( const IContext& context ) const override
+	{
+		const Context system_context( context );
+		const u32 count = m_chunkedQuery->Count();
+
+		WorkerPool& worker_pool = onyx::LowLevel::GetWorkerPool();
+		const u32 max_chunks = ( worker_pool.GetWorkerCount() + 1 ) * c_chunksPerThread;
+		const u32 chunk_count = std::clamp( count / MinCount, 1u, max_chunks );
+
+		if ( chunk_count == 1 )
+		{
+			RunChunk( system_context, 0, count );
+			return;
+		}
+
+		ZoneScopedN( "Run system in chunks" );
+
+		// kept from run to run, so the chunks' copies of context members can reuse their memory
+		while ( m_chunkJobs.size() < chunk_count )
+			m_chunkJobs.push_back( std::make_unique< ChunkJob >( *this ) );
+
+		m_chunkJobPtrs.clear();
+		for ( u32 chunk_index = 0; chunk_index < chunk_count; ++chunk_index )
+		{
+			ChunkJob& job = *m_chunkJobs[ chunk_index ];
+			job.m_context = &system_context;
+			job.m_begin = u32( u64( count ) * chunk_index / chunk_count );
+			job.m_end = u32( u64( count ) * ( chunk_index + 1 ) / chunk_count );
+			job.m_chunkContext.Reset();
+
+			m_chunkJobPtrs.push_back( &job );
+		}
+
+		worker_pool.RunAndWait( m_chunkJobPtrs );
+
+		// the copies are reset as soon as they're merged, so they don't hold on to anything until the next run
+		for ( u32 chunk_index = 0; chunk_index < chunk_count; ++chunk_index )
+		{
+			ChunkContext< Context >& chunk_context = m_chunkJobs[ chunk_index ]->m_chunkContext;
+			chunk_context.MergeInto( system_context );
+			chunk_context.Reset();
+		}
+	}
+
+private:
+	constexpr static u32 c_chunksPerThread = 4;
+
+	struct ChunkJob : IJob
+	{
+		ChunkJob( const System& system ) : m_system( system ) {}
+
+		void Run() override { m_system.RunChunk( m_chunkContext.MakeContext( *m_context ), m_begin, m_end ); }
+
+		const System& m_system;
+		const Context* m_context = nullptr;
+		u32 m_begin = 0;
+		u32 m_end = 0;
+		ChunkContext< Context > m_chunkContext;
+	};
+
+	void RunChunk( const Context& context, u32 begin, u32 end ) const
+	{
+		( *m_callback )( context, SystemChunk( *m_chunkedQuery, begin, end ), *std::get< std::shared_ptr< Queries > >( m_queries ) ... );
+	}
+
+	static SystemAccess CollectAccess()
+	{
+		SystemAccess access;
+		access.components = ( ChunkedQuery::GetComponentSet() | ... | Queries::GetComponentSet() );
+		access.writtenComponents = ( ChunkedQuery::GetWrittenComponentSet() | ... | Queries::GetWrittenComponentSet() );
+		Context::CollectAccess( access.contextTypes, access.writtenContextTypes );
+		return access;
+	}
+
+	Func* const m_callback;
+	std::shared_ptr< ChunkedQuery > m_chunkedQuery;
+	std::tuple< std::shared_ptr< Queries > ... > m_queries;
+
+	// the system only runs once at a time, so these can be reused while it's const
+	mutable std::vector< std::unique_ptr< ChunkJob > > m_chunkJobs;
+	mutable std::vector< IJob* > m_chunkJobPtrs;
+};
+
 }
@@ -5,80 +5,250 @@
 #include "System.h"
 #include "Onyx/Multithreading.h"
 
+#include <algorithm>
 #include <vector>
 #include <memory>
+#include <optional>
+#include <unordered_map>
 
 namespace onyx::ecs
 {
 
+// a dependency between two systems in a set, by the order they were added
+using SystemDependency = std::tuple< u32, u32 >;
+
+// lets system sets with different contexts be scheduled together, see FrameGraph
+struct ISystemSet
+{
+	virtual ~ISystemSet() = default;
+
+	virtual u32 GetSystemCount() const = 0;
+	virtual const SystemAccess& GetSystemAccess( u32 system_index ) const = 0;
+	virtual const char* GetSystemName( u32 system_index ) const = 0;
+
+	// the manual and inferred dependencies between the systems in the set
+	virtual const std::vector< SystemDependency >& GetDependencies() = 0;
+
+	// the job reads the set's context when it runs, so the context can change without the job being rebuilt
+	virtual IJob& AddSystemJob( JobGraph& graph, u32 system_index ) = 0;
+
+	// changes whenever a system or dependency is added
+	u32 GetRevision() const { return m_revision; }
+
+protected:
+	u32 m_revision = 0;
+};
+
 template< typename ... Components >
-struct SystemSet
+struct SystemSet : ISystemSet
 {
 	using IContext = Context< Components ... >;
 
 	SystemSet( QuerySet& query_set ) : m_querySet( query_set ) {}
 
-	// add a system to run in parallel with everything else
+	// add a system to run in parallel with everything it doesn't conflict with
+	// systems that write something another system uses run in the order they were added, unless a dependency says otherwise
+	// the name is only used to label the system's job when the graph is exported
 	template< typename Func >
-	void AddSystem( Func* callback )
+	void AddSystem( Func* callback, const char* name = nullptr )
 	{
 		m_systems.push_back( std::make_unique< System< IContext, Func > >( m_querySet, callback ) );
+		m_systemNames.push_back( name );
+		++m_revision;
 	}
 
 	template< typename Func1, typename Func2 >
 	void AddDependency( Func1* first, Func2* second )
 	{
 		m_dependencies.push_back( { (u64)first, (u64)second } );
+		++m_revision;
+	}
+
+	u32 GetSystemCount() const override { return (u32)m_systems.size(); }
+	const SystemAccess& GetSystemAccess( u32 system_index ) const override { return m_systems[ system_index ]->GetAccess(); }
+	const char* GetSystemName( u32 system_index ) const override { return m_systemNames[ system_index ]; }
+
+	const std::vector< SystemDependency >& GetDependencies() override
+	{
+		if ( m_edgesRevision != m_revision )
+			InferDependencies();
+
+		return m_edges;
+	}
+
+	IJob& AddSystemJob( JobGraph& graph, u32 system_index ) override
+	{
+		IJob& job = graph.AddJob< RunSystemJob >( *m_systems[ system_index ], m_context );
+		job.name = m_systemNames[ system_index ];
+		return job;
 	}
 
+	// the set's own graph, for exporting, it's empty until the set has run on its own
+	const JobGraph& GetJobGraph() const { return m_graph; }
+
 private:
 	QuerySet& m_querySet;
 	std::vector< std::tuple< u64, u64 > > m_dependencies;
 	std::vector< std::unique_ptr< const ISystem< IContext > > > m_systems;
+	std::vector< const char* > m_systemNames;
+
+	// worked out the first time they're needed after a system or dependency is added
+	std::vector< SystemDependency > m_edges;
+	u32 m_edgesRevision = UINT32_MAX;
+
+	// built the first time the set runs on its own after a system or dependency is added, then reused every frame
+	JobGraph m_graph;
+	u32 m_graphRevision = UINT32_MAX;
+
+	// the jobs read the context from here, so that they don't need rebuilding when it changes
+	std::optional< IContext > m_context;
 
 	struct RunSystemJob : IJob
 	{
-		RunSystemJob( const ISystem< IContext >& system, const IContext& context )
+		RunSystemJob( const ISystem< IContext >& system, const std::optional< IContext >& context )
 			: m_system( system )
 			, m_context( context )
 		{}
 
-		void Run() override { m_system.Run( m_context ); }
+		void Run() override { m_system.Run( *m_context ); }
 
 	private:
 		const ISystem< IContext >& m_system;
-		const IContext m_context;
+		const std::optional< IContext >& m_context;
 	};
 
-public:
-	void Run( Components& ... components )
+	// whether following the edges from first reaches second, optionally ignoring one of them
+	static bool IsOrdered( const std::vector< SystemDependency >& edges, u32 system_count, u32 first, u32 second, size_t ignored_edge = SIZE_MAX )
+	{
+		std::vector< bool > reached( system_count, false );
+		std::vector< u32 > stack = { first };
+
+		while ( !stack.empty() )
+		{
+			const u32 system = stack.back();
+			stack.pop_back();
+
+			for ( size_t edge_index = 0; edge_index < edges.size(); ++edge_index )
+			{
+				const auto [from, to] = edges[ edge_index ];
+				if ( from != system || edge_index == ignored_edge || reached[ to ] )
+					continue;
+
+				if ( to == second )
+					return true;
+
+				reached[ to ] = true;
+				stack.push_back( to );
+			}
+		}
+
+		return false;
+	}
+
+	void InferDependencies()
 	{
 		ZoneScoped;
 
-		IContext context( components ... );
+		const u32 system_count = (u32)m_systems.size();
+
+		std::unordered_map< u64, u32 > system_indices;
+		system_indices.reserve( system_count );
 
-		WorkerPool& worker_pool = onyx::LowLevel::GetWorkerPool();
-		JobQueue& job_queue = worker_pool.GetJobQueue();
+		for ( u32 index = 0; index < system_count; ++index )
+			system_indices[ m_systems[ index ]->GetID() ] = index;
 
-		job_queue.Reserve( (u32)m_systems.size() );
+		// conflicting systems in the order they were added
+		std::vector< SystemDependency > inferred_edges;
+		for ( u32 first = 0; first < system_count; ++first )
+			for ( u32 second = first + 1; second < system_count; ++second )
+				if ( m_systems[ first ]->GetAccess().ConflictsWith( m_systems[ second ]->GetAccess() ) )
+					inferred_edges.push_back( { first, second } );
 
+		std::vector< SystemDependency >& edges = m_edges;
+		edges.clear();
+
+		for ( auto& [first, second] : m_dependencies )
 		{
-			ZoneScopedN( "Adding System Jobs to queue" );
+			auto first_index = system_indices.find( first );
+			auto second_index = system_indices.find( second );
 
-			for ( auto& system : m_systems )
-				job_queue.AddJob< RunSystemJob >( system->GetID(), *system, context );
+			if ( WEAK_ASSERT( first_index != system_indices.end() && second_index != system_indices.end(), "Dependency between systems that aren't in this set" ) )
+				edges.push_back( { first_index->second, second_index->second } );
 		}
 
+		const size_t manual_edge_count = edges.size();
+
+		// manual dependencies win, so only the inferred edges that don't contradict them are used
+		// inferred edges only ever point forwards, so anything running the other way is down to a manual dependency
+		for ( const auto [first, second] : inferred_edges )
 		{
-			ZoneScopedN( "Adding dependencies to queue" );
+			if ( IsOrdered( edges, system_count, second, first ) )
+			{
+				WARN( "Systems {} ({:#x}) and {} ({:#x}) conflict, and a manual dependency runs them in the opposite order to the one they were added in",
+					first, m_systems[ first ]->GetID(), second, m_systems[ second ]->GetID() );
+				continue;
+			}
+
+			// that's the normal case now, so it's only worth seeing when tracking down an ordering problem
+			if ( !IsOrdered( edges, system_count, first, second ) )
+				TRACE( "Systems {} ({:#x}) and {} ({:#x}) conflict, running them in the order they were added",
+					first, m_systems[ first ]->GetID(), second, m_systems[ second ]->GetID() );
+
+			edges.push_back( { first, second } );
+		}
 
-			for ( auto& [first, second] : m_dependencies )
-				if ( IJob* const first_job = WEAK_ASSERT( job_queue.GetJob( first ) ) )
-					if ( IJob* const second_job = WEAK_ASSERT( job_queue.GetJob( second ) ) )
-						second_job->AddDependency( first_job );
+		// a manual dependency is redundant if the rest of the graph already implies it, e.g. if it duplicates an inferred edge
+		for ( size_t edge_index = 0; edge_index < manual_edge_count; ++edge_index )
+		{
+			const auto [first, second] = edges[ edge_index ];
+			if ( IsOrdered( edges, system_count, first, second, edge_index ) )
+				WARN( "The dependency of system {} ({:#x}) on system {} ({:#x}) is redundant",
+					second, m_systems[ second ]->GetID(), first, m_systems[ first ]->GetID() );
 		}
 
-		worker_pool.Begin();
+		std::sort( edges.begin(), edges.end() );
+		edges.erase( std::unique( edges.begin(), edges.end() ), edges.end() );
+
+		m_edgesRevision = m_revision;
+	}
+
+	void BuildGraph()
+	{
+		ZoneScoped;
+
+		m_graph.Reset();
+		m_graph.Reserve( GetSystemCount() );
+
+		std::vector< IJob* > system_jobs;
+		system_jobs.reserve( GetSystemCount() );
+
+		for ( u32 system_index = 0; system_index < GetSystemCount(); ++system_index )
+			system_jobs.push_back( &AddSystemJob( m_graph, system_index ) );
+
+		for ( const auto [first, second] : GetDependencies() )
+			system_jobs[ second ]->AddDependency( system_jobs[ first ] );
+
+		m_graphRevision = m_revision;
+	}
+
+public:
+	// the jobs from the last run might still be reading the context, so this waits for them first
+	void SetContext( Components& ... components )
+	{
+		onyx::LowLevel::GetWorkerPool().Wait();
+		m_context.emplace( components ... );
+	}
+
+	void Run( Components& ... components )
+	{
+		ZoneScoped;
+
+		SetContext( components ... );
+
+		if ( m_graphRevision != m_revision )
+			BuildGraph();
+
+		onyx::LowLevel::GetWorkerPool().Begin( m_graph );
 	}
 };
 
@@ -2,6 +2,8 @@
 
 #include "Modules/Core.h"
 
+#include <atomic>
+
 namespace onyx::ecs
 {
 
@@ -9,98 +11,344 @@ void World::ResetEntities()
 {
 	m_componentTables.clear();
 	m_nextEntityID = 1;
+	m_generations.clear();
+	m_freeIndices.clear();
+	m_freeIndicesSorted = true;
+	m_reservedFreeCount = 0;
+	m_reservedNewCount = 0;
+	m_hierarchy.Clear();
+}
+
+void World::ReserveEntityIDs( std::span< EntityID > ids )
+{
+	const u32 count = u32( ids.size() );
+	if ( !count )
+		return;
+
+	// nothing changes m_freeIndices until the next flush, so its size can be read while other threads reserve
+	const u32 free_count = m_recycleEntityIDs ? u32( m_freeIndices.size() ) : 0;
+	const u32 first_free = std::atomic_ref( m_reservedFreeCount ).fetch_add( count, std::memory_order_relaxed );
+	const u32 recycled_count = first_free < free_count ? std::min( count, free_count - first_free ) : 0;
+
+	for ( u32 id_index = 0; id_index < recycled_count; ++id_index )
+		ids[ id_index ] = GetEntityAtIndex( m_freeIndices[ first_free + id_index ] );
+
+	if ( recycled_count == count )
+		return;
+
+	const u32 first_new = std::atomic_ref( m_reservedNewCount ).fetch_add( count - recycled_count, std::memory_order_relaxed );
+
+	// the last index is reserved as the end marker for entity iterators
+	STRONG_ASSERT( m_nextEntityID.GetIndex() + first_new + count - recycled_count <= EntityID::c_indexMask, "Ran out of entity ids" );
+
+	for ( u32 id_index = recycled_count; id_index < count; ++id_index )
+		ids[ id_index ] = EntityID( u32( m_nextEntityID ) + first_new + id_index - recycled_count );
+}
+
+void World::FlushReservedEntityIDs()
+{
+	ZoneScoped;
+
+	// reservations can overshoot the free list, the rest came from m_nextEntityID
+	const u32 recycled_count = std::min< u32 >( m_reservedFreeCount, m_recycleEntityIDs ? u32( m_freeIndices.size() ) : 0 );
+
+	// what's left of a sorted list is still sorted, and so still a min heap
+	m_freeIndices.erase( m_freeIndices.begin(), m_freeIndices.begin() + recycled_count );
+	m_nextEntityID = u32( m_nextEntityID ) + m_reservedNewCount;
+
+	m_reservedFreeCount = 0;
+	m_reservedNewCount = 0;
+
+	if ( !m_freeIndicesSorted )
+	{
+		std::sort( m_freeIndices.begin(), m_freeIndices.end() );
+		m_freeIndicesSorted = true;
+	}
+}
+
+void World::ReleaseEntityIDs( std::span< const EntityID > ids )
+{
+	FlushReservedEntityIDs();
+
+	// worlds that don't recycle ids just leave a gap
+	if ( ids.empty() || !m_recycleEntityIDs )
+		return;
+
+	// they were never given out, so their generations don't need bumping
+	for ( const EntityID entity : ids )
+		m_freeIndices.push_back( entity.GetIndex() );
+
+	std::sort( m_freeIndices.begin(), m_freeIndices.end() );
+}
+
+EntityID World::AllocateEntityID()
+{
+	if ( m_reservedFreeCount || m_reservedNewCount )
+		FlushReservedEntityIDs();
+
+	if ( m_recycleEntityIDs && !m_freeIndices.empty() )
+	{
+		std::pop_heap( m_freeIndices.begin(), m_freeIndices.end(), std::greater<>() );
+		const u32 index = m_freeIndices.back();
+		m_freeIndices.pop_back();
+		m_freeIndicesSorted = false;
+
+		return GetEntityAtIndex( index );
+	}
+
+	// the last index is reserved as the end marker for entity iterators
+	STRONG_ASSERT( m_nextEntityID.GetIndex() < EntityID::c_indexMask, "Ran out of entity ids" );
+	return m_nextEntityID++;
+}
+
+void World::UpdateAttachment( EntityID entity, EntityID parent )
+{
+	const u32 index = entity.GetIndex();
+
+	if ( !parent || !IsAlive( parent ) || parent.GetIndex() == index || m_hierarchy.IsDescendant( parent.GetIndex(), index ) )
+	{
+		m_hierarchy.Detach( index );
+		return;
+	}
+
+	m_hierarchy.Attach( index, parent.GetIndex() );
 }
 
 void World::RemoveEntity( EntityID entity, bool and_children )
+{
+	RemoveEntities( std::span( &entity, 1 ), and_children );
+}
+
+void World::RemoveEntities( std::span< const EntityID > entities, bool and_children )
 {
 	ZoneScoped;
 
-	for ( auto& [hash, table] : m_componentTables )
-		table.RemoveComponent( entity );
+	// the entities might have already been removed, e.g. by two commands in the same frame
+	std::vector< EntityID > removing;
+	removing.reserve( entities.size() );
 
+	for ( const EntityID entity : entities )
+		if ( IsAlive( entity ) )
+			removing.push_back( entity );
+
+	if ( removing.empty() )
+		return;
+
+	// the hierarchy links each entity to its children, so this only touches the subtrees being removed
 	if ( and_children )
 	{
-		if ( ComponentTable< onyx::Core::AttachedTo >* attached_to_table = GetOptionalComponentTable< onyx::Core::AttachedTo >() )
-		{
-			std::vector< EntityID > children;
+		const size_t root_count = removing.size();
+		for ( size_t root_index = 0; root_index < root_count; ++root_index )
+			m_hierarchy.VisitDescendants( removing[ root_index ].GetIndex(), [ this, &removing ]( u32 index ) { removing.push_back( GetEntityAtIndex( index ) ); } );
+	}
 
-			for ( auto attached_to_iter = attached_to_table->Iter(); attached_to_iter; attached_to_iter.GoToNext() )
-				if ( attached_to_iter.GetComponent()->localeEntity == entity )
-					children.push_back( attached_to_iter.GetEntityID() );
+	// sorted, so each table walks its pages in order, systems usually record them in order already
+	if ( !std::is_sorted( removing.begin(), removing.end() ) )
+		std::sort( removing.begin(), removing.end() );
 
-			for ( EntityID child : children )
-				RemoveEntity( child, and_children );
+	removing.erase( std::unique( removing.begin(), removing.end() ), removing.end() );
+
+	for ( std::unique_ptr< GenericComponentTable >& table : m_componentTables )
+		if ( table )
+			table->RemoveComponents( removing );
+
+	for ( const EntityID entity : removing )
+		m_hierarchy.Remove( entity.GetIndex() );
+
+	// even worlds that don't recycle ids bump the generation, so the removed ids stop being alive
+	if ( removing.back().GetIndex() >= m_generations.size() )
+		m_generations.resize( removing.back().GetIndex() + 1, 0 );
+
+	for ( const EntityID entity : removing )
+	{
+		const u32 index = entity.GetIndex();
+		m_generations[ index ] = ( m_generations[ index ] + 1 ) & EntityID::c_generationMask;
+	}
+
+	if ( m_recycleEntityIDs )
+	{
+		for ( const EntityID entity : removing )
+		{
+			m_freeIndices.push_back( entity.GetIndex() );
+			std::push_heap( m_freeIndices.begin(), m_freeIndices.end(), std::greater<>() );
 		}
+
+		m_freeIndicesSorted = false;
 	}
 }
 
-World::EntityIterator::EntityIterator( World& world, const std::set< size_t >* relevant_components, bool dirty_only )
-	: m_dirtyOnly( dirty_only )
+World::EntityIterator::EntityIterator( World& world, const ComponentSet* relevant_components, bool dirty_only, const ComponentSet* required_components )
+	: m_world( &world )
+	, m_dirtyOnly( dirty_only )
 {
-	for ( auto& [hash, table] : world.m_componentTables )
+	// dirty entities may have just lost a required component, so they're all still relevant
+	if ( dirty_only )
+		required_components = nullptr;
+
+	AddTables( world, relevant_components, required_components );
+
+	if ( required_components )
 	{
-		if ( relevant_components && !relevant_components->contains( hash ) )
+		// a required component nobody has yet means there's nothing to visit
+		if ( m_required.size() != required_components->count() )
+			return;
+
+		// the smallest table rules out the most chunks, so check it first
+		std::sort( m_required.begin(), m_required.end(), [ this ]( u8 lhs, u8 rhs ) {
+			return m_tables[ lhs ].m_table->GetPagePool().GetLiveBlockCount() < m_tables[ rhs ].m_table->GetPagePool().GetLiveBlockCount();
+		} );
+	}
+
+	FindChunk();
+}
+
+World::EntityIterator::EntityIterator( World& world, const ComponentSet* relevant_components, std::span< const u32 > entity_indices )
+	: m_world( &world )
+	, m_walkingEntityIndices( true )
+	, m_entityIndices( entity_indices )
+{
+	AddTables( world, relevant_components, nullptr );
+
+	if ( !entity_indices.empty() )
+		MoveTo( entity_indices.front() );
+}
+
+void World::EntityIterator::AddTables( World& world, const ComponentSet* relevant_components, const ComponentSet* required_components )
+{
+	for ( ComponentID component_id = 0; component_id < world.m_componentTables.size(); ++component_id )
+	{
+		const bool required = required_components && required_components->test( component_id );
+		if ( !required && relevant_components && !relevant_components->test( component_id ) )
 			continue;
 
-		GenericComponentTable::Iterator iter( table, !dirty_only );
+		GenericComponentTable* const table = world.m_componentTables[ component_id ].get();
+		if ( !table )
+			continue;
 
-		if ( m_dirtyOnly )
-		{
-			if ( iter.IsDirty() )
-			{
-				if ( const EntityID first_entity = iter.GetEntityID() )
-					m_currentEntity = std::min< u32 >( m_currentEntity, first_entity );
-			}
-			else if ( const EntityID first_entity = iter.FindNextDirtyEntityID() )
-				m_currentEntity = std::min< u32 >( m_currentEntity, first_entity );
-		}
-		else
-		{
-			if ( const EntityID first_entity = iter.GetEntityID() )
-				m_currentEntity = std::min< u32 >( m_currentEntity, first_entity );
-		}
+		m_tables.push_back( { component_id, table } );
+		m_tableSlots[ component_id ] = u8( m_tables.size() );
 
-		m_iterators.insert( { hash, iter } );
+		if ( required )
+			m_required.push_back( u8( m_tables.size() - 1 ) );
 	}
 }
 
 World::EntityIterator& World::EntityIterator::operator ++()
 {
-	// find the lowest next entity ID
-	EntityID lowest_next_entity_id = UINT32_MAX;
-	for ( auto& [_, iter] : m_iterators )
+	if ( !*this )
+		return *this;
+
+	if ( m_walkingEntityIndices )
+	{
+		if ( ++m_entityIndexPosition < m_entityIndices.size() )
+			MoveTo( m_entityIndices[ m_entityIndexPosition ] );
+		else
+			m_currentEntity = UINT32_MAX;
+
+		return *this;
+	}
+
+	// clear the lowest bit, that's the entity we're on
+	m_chunkMask &= m_chunkMask - 1;
+
+	if ( !m_chunkMask )
 	{
-		if ( m_dirtyOnly )
+		++m_chunkIndex;
+		FindChunk();
+		return *this;
+	}
+
+	MoveTo( ( m_chunkIndex << GenericComponentTable::c_chunkShift ) + std::countr_zero( m_chunkMask ) );
+	return *this;
+}
+
+void World::EntityIterator::FindChunk()
+{
+	for ( ;; )
+	{
+		m_chunkMask = 0;
+
+		if ( m_required.empty() )
 		{
-			if ( const EntityID curr = iter.GetEntityID(); curr > m_currentEntity && iter.IsDirty() )
-				lowest_next_entity_id = std::min( lowest_next_entity_id, curr );
-			else if ( const EntityID next_dirty = iter.FindNextDirtyEntityID() )
-				lowest_next_entity_id = std::min( lowest_next_entity_id, next_dirty );
+			// the union starts at the earliest chunk of any table
+			u32 next_chunk = UINT32_MAX;
+			for ( const TableCursor& cursor : m_tables )
+				next_chunk = std::min( next_chunk, cursor.m_table->FindChunk( m_chunkIndex ) );
+
+			if ( next_chunk == UINT32_MAX )
+				break;
+
+			m_chunkIndex = next_chunk;
+			for ( const TableCursor& cursor : m_tables )
+				m_chunkMask |= cursor.m_table->GetChunkMask( m_chunkIndex, m_dirtyOnly );
 		}
 		else
 		{
-			if ( const EntityID curr = iter.GetEntityID(); curr > m_currentEntity )
-				lowest_next_entity_id = std::min( lowest_next_entity_id, curr );
-			else if ( const EntityID next = iter.GetNextEntityID() )
-				lowest_next_entity_id = std::min( lowest_next_entity_id, next );
+			// the join can't start until the latest of the required tables' next chunks, so leapfrog until they agree
+			u32 next_chunk = m_chunkIndex;
+			for ( size_t i = 0; i < m_required.size() && next_chunk != UINT32_MAX; )
+			{
+				const u32 table_chunk = m_tables[ m_required[ i ] ].m_table->FindChunk( next_chunk );
+				if ( table_chunk == next_chunk )
+				{
+					++i;
+					continue;
+				}
+
+				next_chunk = table_chunk;
+				i = 0;
+			}
+
+			if ( next_chunk == UINT32_MAX )
+				break;
+
+			m_chunkIndex = next_chunk;
+			m_chunkMask = ~0ull;
+			for ( size_t i = 0; i < m_required.size() && m_chunkMask; ++i )
+				m_chunkMask &= m_tables[ m_required[ i ] ].m_table->GetChunkMask( m_chunkIndex, false );
+		}
+
+		if ( m_chunkMask )
+		{
+			MoveTo( ( m_chunkIndex << GenericComponentTable::c_chunkShift ) + std::countr_zero( m_chunkMask ) );
+			return;
 		}
+
+		++m_chunkIndex;
 	}
 
-	// progress to that entity ID
-	m_currentEntity = lowest_next_entity_id;
-	for ( auto& [_, iter] : m_iterators )
-		iter.GoTo( lowest_next_entity_id );
+	m_currentEntity = UINT32_MAX;
+}
+
+void World::EntityIterator::MoveTo( u32 entity_index )
+{
+	m_currentEntity = entity_index;
 
-	return *this;
+	for ( TableCursor& cursor : m_tables )
+	{
+		const u32 page_index = cursor.m_table->GetPageIndex( m_currentEntity );
+		if ( page_index == cursor.m_pageIndex )
+			continue;
+
+		cursor.m_pageIndex = page_index;
+		cursor.m_page = cursor.m_table->GetPage( page_index );
+	}
+}
+
+void World::EntityIterator::ResetDirtyFlags()
+{
+	for ( TableCursor& cursor : m_tables )
+		if ( cursor.m_page )
+			cursor.m_page->RemoveDirtyFlag( cursor.m_table->GetIndexInPage( m_currentEntity ) );
 }
 
 EntityID World::EntityIterator::CopyToWorld( World& world ) const
 {
 	const EntityID entity = world.AddEntity();
 
-	for ( const auto& [type, comp] : m_iterators )
-		if ( comp.GetEntityID() == GetEntityID() )
-			comp.CopyToWorld( world, entity );
+	for ( const TableCursor& cursor : m_tables )
+		if ( cursor.HasComponent( m_currentEntity ) )
+			cursor.m_table->CopyComponentToWorld( world, *cursor.m_page, cursor.m_table->GetIndexInPage( m_currentEntity ), entity );
 
 	return entity;
 }
@@ -112,32 +360,48 @@ void World::QueryManager::UpdateNeedsRerun( World& world )
 		return pair.second.expired();
 	} );
 
-	std::set< size_t > changed_components;
+	ComponentSet changed_components;
 
-	for ( auto& [hash, table] : world.m_componentTables )
+	for ( ComponentID component_id = 0; component_id < world.m_componentTables.size(); ++component_id )
 	{
-		if ( table.HasChanged() )
+		GenericComponentTable* const table = world.m_componentTables[ component_id ].get();
+		if ( table && table->HasChanged() )
 		{
-			changed_components.insert( hash );
-			table.ResetHasChanged();
+			changed_components.set( component_id );
+			table->ResetHasChanged();
 		}
 	}
 
-	for ( const size_t& component_type_hash : changed_components )
+	if ( changed_components.any() )
 		for ( auto& [hash, query] : m_queries )
-			query.lock()->OnComponentAddedOrRemoved( component_type_hash );
+			query.lock()->OnComponentsAddedOrRemoved( changed_components );
 }
 
-void World::CleanUpPages()
+u32 World::CollectChanges( const ComponentSet& components, std::vector< u32 >& entity_indices ) const
 {
-	for ( auto& [_, table] : m_componentTables )
-		table.CleanUpPages();
+	ZoneScoped;
+
+	entity_indices.clear();
+
+	for ( ComponentID component_id = 0; component_id < m_componentTables.size(); ++component_id )
+		if ( const GenericComponentTable* const table = m_componentTables[ component_id ].get(); table && components.test( component_id ) )
+			entity_indices.insert( entity_indices.end(), table->GetChangeLog().begin(), table->GetChangeLog().end() );
+
+	const u32 change_count = u32( entity_indices.size() );
+
+	std::sort( entity_indices.begin(), entity_indices.end() );
+	entity_indices.erase( std::unique( entity_indices.begin(), entity_indices.end() ), entity_indices.end() );
+
+	return change_count;
 }
 
-GenericComponentTable* World::GetComponentTableByHash( size_t component_type_hash )
+void World::CleanUpPages()
 {
-	auto iter = m_componentTables.find( component_type_hash );
-	return iter == m_componentTables.end() ? nullptr : &iter->second;
+	for ( std::unique_ptr< GenericComponentTable >& table : m_componentTables )
+		if ( table )
+			table->CleanUpPages();
+
+	m_hierarchy.ClearAttached();
 }
 
 }
@@ -2,15 +2,23 @@
 
 #include <map>
 #include <set>
+#include <span>
+#include <array>
 #include <memory>
 #include <vector>
 #include <algorithm>
+#include <functional>
 
 #include "Entity.h"
+#include "ComponentRegistry.h"
 #include "ComponentTable.h"
+#include "Hierarchy.h"
 
 #include "tracy/Tracy.hpp"
 
+// forward declaration from "Onyx/ECS/Modules/Core.h"
+namespace onyx::Core { struct AttachedTo; }
+
 namespace onyx::ecs
 {
 
@@ -22,22 +30,53 @@ struct Scene;
 
 struct World
 {
+	World() = default;
+
+	// worlds that get saved with their entity ids (i.e. scenes) can opt out of recycling them
+	// so that ids keep being handed out in order
+	explicit World( bool recycle_entity_ids ) : m_recycleEntityIDs( recycle_entity_ids ) {}
+
 	template< typename ... Components >
 	EntityID AddEntity( Components&& ... components )
 	{
-		const EntityID entity = m_nextEntityID++;
+		const EntityID entity = AllocateEntityID();
 		AddComponents( entity, std::move( components ) ... );
 		return entity;
 	}
 
 	void RemoveEntity( EntityID entity, bool and_children = false );
 
+	// removes them all in one go, so each component table only gets visited once
+	void RemoveEntities( std::span< const EntityID > entities, bool and_children = false );
+
 	void ResetEntities();
 
+	// thread safe, fills ids with the ids AddEntity would hand out next, recycled indices lowest first
+	// nothing else gets them, and they can be given components straight away once FlushReservedEntityIDs has been called
+	// which has to happen before anything else adds or removes entities
+	void ReserveEntityIDs( std::span< EntityID > ids );
+	void FlushReservedEntityIDs();
+
+	// gives back reserved ids that were never used
+	void ReleaseEntityIDs( std::span< const EntityID > ids );
+
+	// false if the entity has been removed, whether or not its index has been recycled since
+	inline bool IsAlive( EntityID entity ) const { return entity.GetGeneration() == GetGeneration( entity.GetIndex() ); }
+
+	// the id of the entity currently using the given index
+	inline EntityID GetEntityAtIndex( u32 index ) const { return EntityID( index, GetGeneration( index ) ); }
+
 	template< typename Component >
 	Component& AddComponent( EntityID entity, Component&& component )
 	{
-		return GetComponentTable< Component >().AddComponent( entity, std::move( component ) );
+#		if _DEBUG
+		STRONG_ASSERT( IsAlive( entity ), "Adding a component to a stale entity id: {}", entity );
+#		endif
+
+		Component& added = GetComponentTable< Component >().AddComponent( entity, std::move( component ) );
+		OnComponentAdded( entity, added );
+
+		return added;
 	}
 
 	template< typename ... Components >
@@ -49,42 +88,137 @@ struct World
 	template< typename Component >
 	void RemoveComponent( EntityID entity )
 	{
+		if ( !IsAlive( entity ) )
+			return;
+
+		if constexpr ( std::is_same_v< Component, onyx::Core::AttachedTo > )
+			m_hierarchy.Detach( entity.GetIndex() );
+
 		GetComponentTable< Component >().RemoveComponent( entity );
 	}
 
+	// anything that adds components straight to a table has to call this afterwards, so the hierarchy sees new attachments
+	template< typename Component >
+	void OnComponentAdded( EntityID entity, const Component& component )
+	{
+		if constexpr ( std::is_same_v< Component, onyx::Core::AttachedTo > )
+			UpdateAttachment( entity, component.localeEntity );
+	}
+
+	// links the entity under its new parent, AttachedTo has to be added again to change it, rather than edited in place
+	// entities attached to nothing, to removed entities, or to their own descendants are left as roots
+	void UpdateAttachment( EntityID entity, EntityID parent );
+
+	// the parent the entity is attached to, if it's still alive
+	EntityID GetParent( EntityID entity ) const
+	{
+		const u32 parent = m_hierarchy.GetParent( entity.GetIndex() );
+		return IsAlive( entity ) && parent != EntityHierarchy::c_none ? GetEntityAtIndex( parent ) : NoEntity;
+	}
+
+	template< typename Func >
+	void ForEachChild( EntityID entity, const Func& func ) const
+	{
+		if ( !IsAlive( entity ) )
+			return;
+
+		for ( u32 child = m_hierarchy.GetFirstChild( entity.GetIndex() ); child != EntityHierarchy::c_none; child = m_hierarchy.GetNextSibling( child ) )
+			func( GetEntityAtIndex( child ) );
+	}
+
+	// parents before their children
+	template< typename Func >
+	void ForEachDescendant( EntityID entity, const Func& func ) const
+	{
+		if ( IsAlive( entity ) )
+			m_hierarchy.VisitDescendants( entity.GetIndex(), [&]( u32 index ) { func( GetEntityAtIndex( index ) ); } );
+	}
+
+	const EntityHierarchy& GetHierarchy() const { return m_hierarchy; }
+
 	template< typename Component >
 	Component* GetComponent( EntityID entity ) const
 	{
-		return GetComponentTable< Component >().GetComponent( entity );
+		return IsAlive( entity ) ? GetComponentTable< Component >().GetComponent( entity ) : nullptr;
 	}
 
+	// walks the entities in a world 64 at a time, by combining the occupancy (or dirty) bitmaps of each table
+	// with required components, only chunks that every required table has a page for are visited, and their masks are ANDed
+	// otherwise, every entity with any of the relevant components is visited, and the masks are ORed
+	// alternatively, it can walk a sorted list of entity indices, e.g. from CollectChanges
 	struct EntityIterator
 	{
-		std::map< size_t, GenericComponentTable::Iterator > m_iterators;
+		struct TableCursor
+		{
+			ComponentID m_componentID = 0;
+			GenericComponentTable* m_table = nullptr;
+
+			// the page containing the current entity, if the table has one
+			GenericComponentTable::Page* m_page = nullptr;
+			u32 m_pageIndex = UINT32_MAX;
+
+			inline bool HasComponent( EntityID entity ) const
+			{
+				return m_page && m_page->HasComponent( m_table->GetIndexInPage( entity ) );
+			}
+		};
+
+		std::vector< TableCursor > m_tables;
+
+		// one more than the index into m_tables for each component id, 0 if there's no table for it
+		std::array< u8, c_maxComponentTypes > m_tableSlots {};
+
+		// component tables only know about indices, so this has no generation
 		EntityID m_currentEntity = UINT32_MAX;
+		const World* m_world = nullptr;
 		bool m_dirtyOnly = false;
 
 		EntityIterator() = default;
-		EntityIterator( World& world, const std::set< size_t >* relevant_components = nullptr, bool dirty_only = false );
+		EntityIterator( World& world, const ComponentSet* relevant_components = nullptr, bool dirty_only = false, const ComponentSet* required_components = nullptr );
+		EntityIterator( World& world, const ComponentSet* relevant_components, std::span< const u32 > entity_indices );
 
-		operator bool() const { return (u32)GetEntityID() < UINT32_MAX; }
+		operator bool() const { return (u32)m_currentEntity < UINT32_MAX; }
 		EntityIterator& operator ++();
 
-		EntityID GetEntityID() const { return m_currentEntity; }
+		EntityID GetEntityID() const { return m_world ? m_world->GetEntityAtIndex( m_currentEntity.GetIndex() ) : m_currentEntity; }
 
-		void ResetDirtyFlags() { for ( auto& [_, iter] : m_iterators ) iter.RemoveDirtyFlag(); }
+		void ResetDirtyFlags();
 
 		EntityID CopyToWorld( World& world ) const;
 
 		template< typename Component >
 		Component* Get() const
 		{
-			auto iter = m_iterators.find( typeid( Component ).hash_code() );
-			if ( iter == m_iterators.end() || iter->second.GetEntityID() != GetEntityID() )
+			const u8 slot = m_tableSlots[ ComponentRegistry::GetID< Component >() ];
+			if ( !slot )
+				return nullptr;
+
+			const TableCursor& cursor = m_tables[ slot - 1 ];
+			if ( !cursor.m_page )
 				return nullptr;
 
-			return iter->second.Cast< Component >().GetComponent();
+			return cursor.m_page->GetComponent< Component >( cursor.m_table->GetIndexInPage( m_currentEntity ) );
 		}
+
+	private:
+		// indices into m_tables of the required tables, smallest first, empty if we're taking the union
+		std::vector< u8 > m_required;
+
+		u32 m_chunkIndex = 0;
+
+		// the entities in the current chunk we haven't visited yet
+		u64 m_chunkMask = 0;
+
+		// when walking a list of entities instead of chunks
+		bool m_walkingEntityIndices = false;
+		std::span< const u32 > m_entityIndices;
+		size_t m_entityIndexPosition = 0;
+
+		void AddTables( World& world, const ComponentSet* relevant_components, const ComponentSet* required_components );
+
+		// find the next chunk at or after m_chunkIndex with any entities to visit
+		void FindChunk();
+		void MoveTo( u32 entity_index );
 	};
 
 	struct QueryManager
@@ -113,35 +247,70 @@ struct World
 
 	QueryManager m_queryManager;
 
-	EntityIterator Iter( const std::set< size_t >* relevant_components = nullptr, bool dirty_only = false )
-	{ return EntityIterator( *this, relevant_components, dirty_only ); }
+	EntityIterator Iter( const ComponentSet* relevant_components = nullptr, bool dirty_only = false, const ComponentSet* required_components = nullptr )
+	{ return EntityIterator( *this, relevant_components, dirty_only, required_components ); }
+
+	EntityIterator Iter( const ComponentSet* relevant_components, std::span< const u32 > entity_indices )
+	{ return EntityIterator( *this, relevant_components, entity_indices ); }
+
+	// fill out the sorted indices of the entities that have gained or lost any of the given components since the last CleanUpPages
+	// returns the number of changes logged, which can be more than the number of entities
+	u32 CollectChanges( const ComponentSet& components, std::vector< u32 >& entity_indices ) const;
 
 	void CleanUpPages();
 
 private:
-	std::map< size_t, GenericComponentTable > m_componentTables;
+	// indexed by component id, tables are only created when they are first used
+	std::vector< std::unique_ptr< GenericComponentTable > > m_componentTables;
 	EntityID m_nextEntityID { 1 };
 
+	bool m_recycleEntityIDs = true;
+
+	// the generation of each index that has been removed at least once, anything past the end is still on generation 0
+	std::vector< u16 > m_generations;
+
+	// min heap of removed indices, so the lowest index gets reused first and tables stay packed into their earliest pages
+	// it's sorted when ids are flushed, so that reservations can take the lowest ones from the front
+	std::vector< u32 > m_freeIndices;
+	bool m_freeIndicesSorted = true;
+
+	// how many ids have been reserved from the front of m_freeIndices and from m_nextEntityID since the last flush
+	// these are only used through std::atomic_ref, so that worlds can still be moved
+	u32 m_reservedFreeCount = 0;
+	u32 m_reservedNewCount = 0;
+
+	EntityHierarchy m_hierarchy;
+
 	friend struct Scene;
 
-	GenericComponentTable* GetComponentTableByHash( size_t component_type_hash );
+	EntityID AllocateEntityID();
+
+	inline u32 GetGeneration( u32 index ) const { return index < m_generations.size() ? m_generations[ index ] : 0; }
+
+	inline GenericComponentTable* GetComponentTableByID( ComponentID component_id )
+	{
+		return component_id < m_componentTables.size() ? m_componentTables[ component_id ].get() : nullptr;
+	}
 
 	template< typename Component >
 	ComponentTable< Component >& GetComponentTableInternal()
 	{
-		const size_t component_type_hash = typeid( Component ).hash_code();
+		const ComponentID component_id = ComponentRegistry::GetID< Component >();
+
+		if ( component_id >= m_componentTables.size() )
+			m_componentTables.resize( component_id + 1 );
 
-		auto iter = m_componentTables.find( component_type_hash );
-		if ( iter == m_componentTables.end() )
-			iter = m_componentTables.emplace( component_type_hash, GenericComponentTable::MetaData::s_singleton< Component > ).first;
+		std::unique_ptr< GenericComponentTable >& table = m_componentTables[ component_id ];
+		if ( !table )
+			table = std::make_unique< GenericComponentTable >( GenericComponentTable::MetaData::s_singleton< Component > );
 
-		return iter->second.Cast< Component >();
+		return table->Cast< Component >();
 	}
 
 	template< typename Component >
 	ComponentTable< Component >* GetOptionalComponentTableInternal()
 	{
-		return reinterpret_cast< ComponentTable< Component >* >( GetComponentTableByHash( typeid( Component ).hash_code() ) );
+		return reinterpret_cast< ComponentTable< Component >* >( GetComponentTableByID( ComponentRegistry::GetID< Component >() ) );
 	}
 
 public:
@@ -160,9 +329,16 @@ public:
 };
 
 template< typename Component >
-void GenericComponentTable::MetaData::__CopyComponentToWorld( World& world, Page& page, u8 index, EntityID dst_id )
+void GenericComponentTable::MetaData::__CopyComponentToWorld( World& world, Page& page, u32 index, EntityID dst_id )
 {
-	if ( const Component* const component = page.GetComponent< Component >( index ) )
+	const Component* const component = page.GetComponent< Component >( index );
+	if ( !component )
+		return;
+
+	// attachments still point at entities in the world they were copied from, so they're only linked once PostCopyToWorld has mapped them
+	if constexpr ( std::is_same_v< Component, onyx::Core::AttachedTo > )
+		world.GetComponentTable< Component >().AddComponent( dst_id, Component( *component ) );
+	else
 		world.AddComponent( dst_id, Component( *component ) );
 }
 
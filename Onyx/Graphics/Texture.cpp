@@ -9,6 +9,8 @@
 
 #include "imgui_stdlib.h"
 
+#include <mutex>
+
 namespace onyx
 {
 
@@ -114,7 +116,7 @@ void TextureAsset::Init( u32 width, u32 height, const Pixel* pixels )
 	m_pixels.resize( width * height );
 	std::memcpy( m_pixels.data(), pixels, width * height * sizeof( Pixel ) );
 
-	m_gpuResource.reset();
+	ResetResource();
 }
 
 bool TextureAsset::Import( const char* filename )
@@ -237,10 +239,28 @@ void TextureAsset::DoAssetManagerButton( const char* name, const char* path, f32
 
 std::shared_ptr< ITextureResource > TextureAsset::GetGraphicsResource()
 {
-	if ( GetLoadingState() == LoadingState::Loaded && !m_gpuResource )
-		m_gpuResource = LowLevel::GetGraphicsContext().CreateTextureResource( *this );
+	if ( std::shared_ptr< ITextureResource > resource = m_gpuResource.load( std::memory_order_acquire ) )
+		return resource;
+
+	std::scoped_lock lock( m_gpuResourceMutex );
+
+	// somebody else may have made it while we were waiting for the lock
+	std::shared_ptr< ITextureResource > resource = m_gpuResource.load( std::memory_order_acquire );
+	if ( GetLoadingState() == LoadingState::Loaded && !resource )
+	{
+		resource = LowLevel::GetGraphicsContext().CreateTextureResource( *this );
+		m_gpuResource.store( resource, std::memory_order_release );
+	}
+
+	return resource;
+}
+
+void TextureAsset::ResetResource()
+{
+	std::scoped_lock lock( m_gpuResourceMutex );
 
-	return m_gpuResource;
+	// readers that already have the old resource keep it alive until they're done with it
+	m_gpuResource.store( nullptr, std::memory_order_release );
 }
 
 void TexturePreviewWindow::Run( IFrameContext& frame_context )
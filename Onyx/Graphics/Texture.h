@@ -4,6 +4,9 @@
 
 #include "GraphicsResource.h"
 
+#include <atomic>
+#include <mutex>
+
 namespace onyx
 {
 
@@ -55,10 +58,13 @@ struct TextureAsset final : IAsset
 	ImageFilterMode m_filterMode = ImageFilterMode::Smooth;
 	ImageCompressionMode m_compressionMode = ImageCompressionMode::Lossy;
 
-	void ResetResource() { m_gpuResource.reset(); }
+	void ResetResource();
 
 private:
-	std::shared_ptr< ITextureResource > m_gpuResource;
+	// sprites are collected in parallel, so the resource is created under the lock
+	// it's published atomically, so it can be read without taking the lock, even while it's being reset
+	std::mutex m_gpuResourceMutex;
+	std::atomic< std::shared_ptr< ITextureResource > > m_gpuResource;
 	std::vector< Pixel > m_pixels;
 	glm::uvec2 m_dimensions;
 };
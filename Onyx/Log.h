@@ -15,3 +15,10 @@ void __LogInternal( const char* string );
 #define INFO( fmt, ... ) LOG_INTERNAL( __FUNCTION__, "I", fmt __VA_OPT__( , __VA_ARGS__ ) )
 #define WARN( fmt, ... ) LOG_INTERNAL( __FUNCTION__, "W", fmt __VA_OPT__( , __VA_ARGS__ ) )
 #define ERROR( fmt, ... ) LOG_INTERNAL( __FUNCTION__, "E", fmt __VA_OPT__( , __VA_ARGS__ ) )
+
+// for messages that would be too noisy to log all the time, define ONYX_LOG_TRACE to see them
+#ifdef ONYX_LOG_TRACE
+#define TRACE( fmt, ... ) LOG_INTERNAL( __FUNCTION__, "T", fmt __VA_OPT__( , __VA_ARGS__ ) )
+#else
+#define TRACE( fmt, ... ) do {} while ( false )
+#endif
@@ -78,7 +78,7 @@ void Init( const Config& config, AssetManager* core_asset_manager )
 		break;
 	}
 
-	s_workerPool = new WorkerPool( config.numWorkers );
+	s_workerPool = new WorkerPool( config.numWorkers, config.helpWhileWaiting );
 
 	s_isReady = true;
 }
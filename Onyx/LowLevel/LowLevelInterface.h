@@ -36,6 +36,9 @@ struct Config
 	bool enableImGui = false;
 
 	u32 numWorkers = UINT32_MAX;
+
+	// let the main thread run jobs while it waits on the worker pool
+	bool helpWhileWaiting = true;
 };
 
 void Init( const Config& config, AssetManager* core_asset_manager = nullptr );
@@ -2,6 +2,12 @@
 
 #include "tracy/Tracy.hpp"
 
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <unordered_map>
+#include <utility>
+
 #ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN
 #ifndef NOMINMAX
@@ -13,69 +19,224 @@
 namespace onyx
 {
 
-IJob* JobQueue::GetNextJob( bool& any_unstarted_jobs )
+static u64 GetNanoseconds()
 {
-	any_unstarted_jobs = false;
+	return std::chrono::duration_cast< std::chrono::nanoseconds >( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+// lets RunAndWait find the deque of the worker it's called from
+static thread_local const WorkerPool* s_workerPool = nullptr;
+static thread_local u32 s_workerIndex = 0;
+static thread_local const IJob* s_currentJob = nullptr;
 
-	for ( auto& [_, job] : m_jobs )
+void JobGraph::UpdateCriticalPath()
+{
+	ZoneScoped;
+
+	// order the jobs so each one comes after its dependencies, using the counters as scratch space
+	m_order.clear();
+	for ( auto& job : m_jobs )
 	{
-		if ( job->hasFinished )
-			continue;
+		job->remainingDependencies.store( job->dependencyCount, std::memory_order_relaxed );
+		if ( !job->dependencyCount )
+			m_order.push_back( job.get() );
+	}
 
-		if ( !job->hasStarted.exchange( true ) )
-		{
-			any_unstarted_jobs = true;
+	for ( size_t order_index = 0; order_index < m_order.size(); ++order_index )
+		for ( IJob* const successor : m_order[ order_index ]->successors )
+			if ( successor->remainingDependencies.fetch_sub( 1, std::memory_order_relaxed ) == 1 )
+				m_order.push_back( successor );
 
-			bool can_start = true;
-			for ( const IJob* dependency : job->dependencies )
-			{
-				if ( !dependency->hasFinished )
-					can_start = false;
+	// then work back from the end, each job adds itself onto its longest successor's chain
+	m_criticalPathTime = 0;
+	for ( auto iter = m_order.rbegin(); iter != m_order.rend(); ++iter )
+	{
+		IJob& job = **iter;
 
-				break;
-			}
+		u64 longest_successor = 0;
+		for ( const IJob* const successor : job.successors )
+			longest_successor = std::max( longest_successor, successor->criticalPathTime );
 
-			if ( !can_start )
-			{
-				job->hasStarted = false;
-				continue;
-			}
+		// jobs that haven't run yet count for a nanosecond, so that longer chains still go first
+		job.criticalPathTime = std::max< u64 >( job.averageTime, 1 ) + longest_successor;
+		m_criticalPathTime = std::max( m_criticalPathTime, job.criticalPathTime );
 
-			return job.get();
-		}
+		// RunJob pushes ready successors in this order, and the last one pushed is the first to run
+		std::sort( job.successors.begin(), job.successors.end(), []( const IJob* lhs, const IJob* rhs ) { return lhs->criticalPathTime < rhs->criticalPathTime; } );
 	}
+}
 
-	return nullptr;
+std::vector< const IJob* > JobGraph::GetCriticalPath() const
+{
+	std::vector< const IJob* > path;
+
+	const IJob* job = nullptr;
+	for ( auto& root : m_jobs )
+		if ( !root->dependencyCount && ( !job || root->criticalPathTime > job->criticalPathTime ) )
+			job = root.get();
+
+	while ( job )
+	{
+		path.push_back( job );
+
+		const IJob* next = nullptr;
+		for ( const IJob* const successor : job->successors )
+			if ( !next || successor->criticalPathTime > next->criticalPathTime )
+				next = successor;
+
+		job = next;
+	}
+
+	return path;
+}
+
+static std::string GetJobName( const IJob& job, u32 index )
+{
+	return job.name ? std::string( job.name ) : fmt::format( "Job {}", index );
+}
+
+std::string JobGraph::ExportDOT() const
+{
+	std::unordered_map< const IJob*, u32 > job_indices;
+	for ( u32 index = 0; index < Count(); ++index )
+		job_indices[ m_jobs[ index ].get() ] = index;
+
+	const std::vector< const IJob* > critical_path = GetCriticalPath();
+	auto is_critical = [&]( const IJob* job ) { return std::find( critical_path.begin(), critical_path.end(), job ) != critical_path.end(); };
+
+	std::string dot = fmt::format( "digraph Jobs {{\n\tlabel=\"critical path {:.3f}ms\";\n\tnode [shape=box];\n", f64( m_criticalPathTime ) / 1e6 );
+
+	for ( u32 index = 0; index < Count(); ++index )
+	{
+		const IJob& job = *m_jobs[ index ];
+		dot += fmt::format( "\tjob{} [label=\"{}\\naverage {:.3f}ms\\nlast {:.3f}ms\\npath {:.3f}ms\"{}];\n",
+			index, GetJobName( job, index ), f64( job.averageTime ) / 1e6, f64( job.lastTime ) / 1e6, f64( job.criticalPathTime ) / 1e6,
+			is_critical( &job ) ? ", color=red" : "" );
+	}
+
+	for ( u32 index = 0; index < Count(); ++index )
+	{
+		const IJob& job = *m_jobs[ index ];
+		for ( const IJob* const successor : job.successors )
+			dot += fmt::format( "\tjob{} -> job{}{};\n", index, job_indices[ successor ], is_critical( &job ) && is_critical( successor ) ? " [color=red]" : "" );
+	}
+
+	dot += "}\n";
+	return dot;
+}
+
+std::string JobGraph::ExportJSON() const
+{
+	std::unordered_map< const IJob*, u32 > job_indices;
+	for ( u32 index = 0; index < Count(); ++index )
+		job_indices[ m_jobs[ index ].get() ] = index;
+
+	const std::vector< const IJob* > critical_path = GetCriticalPath();
+
+	// times are in nanoseconds
+	std::string json = fmt::format( "{{\n\t\"criticalPathTime\": {},\n\t\"criticalPath\": [", m_criticalPathTime );
+	for ( size_t path_index = 0; path_index < critical_path.size(); ++path_index )
+		json += fmt::format( "{}{}", path_index ? ", " : "", job_indices[ critical_path[ path_index ] ] );
+
+	json += "],\n\t\"jobs\": [\n";
+
+	for ( u32 index = 0; index < Count(); ++index )
+	{
+		const IJob& job = *m_jobs[ index ];
+
+		json += fmt::format( "\t\t{{ \"index\": {}, \"name\": \"{}\", \"averageTime\": {}, \"lastTime\": {}, \"criticalPathTime\": {}, \"successors\": [",
+			index, GetJobName( job, index ), job.averageTime, job.lastTime, job.criticalPathTime );
+
+		for ( size_t successor_index = 0; successor_index < job.successors.size(); ++successor_index )
+			json += fmt::format( "{}{}", successor_index ? ", " : "", job_indices[ job.successors[ successor_index ] ] );
+
+		json += index + 1 < Count() ? "] },\n" : "] }\n";
+	}
+
+	json += "\t]\n}\n";
+	return json;
+}
+
+void WorkerPool::WorkDeque::Push( IJob* job )
+{
+	std::lock_guard lock( m_mutex );
+	m_jobs.push_back( job );
+}
+
+IJob* WorkerPool::WorkDeque::Pop()
+{
+	std::lock_guard lock( m_mutex );
+	if ( m_head == m_jobs.size() )
+		return nullptr;
+
+	IJob* const job = m_jobs.back();
+	m_jobs.pop_back();
+
+	if ( m_head == m_jobs.size() )
+	{
+		m_jobs.clear();
+		m_head = 0;
+	}
+
+	return job;
 }
 
-bool JobQueue::StartNextAvailableJob()
+IJob* WorkerPool::WorkDeque::Steal()
 {
-	bool any_unstarted_jobs;
+	std::lock_guard lock( m_mutex );
+	if ( m_head == m_jobs.size() )
+		return nullptr;
+
+	IJob* const job = m_jobs[ m_head++ ];
 
-	if ( IJob* const job = GetNextJob( any_unstarted_jobs ) )
+	if ( m_head == m_jobs.size() )
 	{
-		job->Run();
-		job->hasFinished = true;
+		m_jobs.clear();
+		m_head = 0;
 	}
 
-	return any_unstarted_jobs;
+	return job;
 }
 
-WorkerPool::WorkerPool( u32 num_workers )
+WorkerPool::WorkerPool( u32 num_workers, bool help_while_waiting )
+	: m_helpWhileWaiting( help_while_waiting )
 {
 	num_workers = std::min( num_workers, std::thread::hardware_concurrency() );
 	INFO( "Starting {} worker threads", num_workers );
 
+	m_deques.reserve( num_workers + 1 );
+	m_counters.reserve( num_workers + 1 );
+	for ( u32 idx = 0; idx < num_workers + 1; ++idx )
+	{
+		m_deques.push_back( std::make_unique< WorkDeque >() );
+		m_counters.push_back( std::make_unique< WorkerCounters >() );
+	}
+
 	m_workers.reserve( num_workers );
 	for ( u32 idx = 0; idx < num_workers; ++idx )
-		m_workers.push_back( std::jthread( [this, idx, num_workers] { Worker( idx, num_workers ); } ) );
+		m_workers.push_back( std::jthread( [this, idx] { Worker( idx ); } ) );
 }
 
 WorkerPool::~WorkerPool()
 {
-	m_workersShouldStop = true;
 	Wait();
 
+	// let the tasks that have already been submitted finish, so an autosave doesn't get lost on the way out
+	// their callbacks don't get run though
+	while ( m_pendingTasks.load() || m_runningTasks.load() )
+	{
+		if ( std::unique_ptr< ITask > task = FindTask( TaskPriority::Background ) )
+			RunTask( std::move( task ), GetWorkerCount() );
+		else
+			std::this_thread::yield();
+	}
+
+	m_workersShouldStop = true;
+
+	// make sure nobody sleeps through being told to stop
+	m_workEpoch.fetch_add( 1 );
+	m_workEpoch.notify_all();
+
 	for ( auto& thread : m_workers )
 		thread.request_stop();
 
@@ -89,24 +250,390 @@ JobQueue& WorkerPool::GetJobQueue()
 	return m_jobQueue;
 }
 
-void WorkerPool::Begin()
+void WorkerPool::Begin( JobGraph& graph )
 {
 	ZoneScoped;
 
-	m_workersCanStart = std::min< u32 >( ( m_jobQueue.Count() + 1 ) / 2, m_workers.size() );
+	Wait();
+
+	if ( graph.m_jobs.empty() )
+		return;
+
+	graph.UpdateCriticalPath();
+
+	// each job's position goes below the run, so its key says which run of the graph it's from and where it is in it
+	const u64 run_order_key = StartRun();
+	const u32 max_position = ( 1u << ( 32 - IJob::c_orderKeyRunBits ) ) - 1;
+	WEAK_ASSERT_ONCE( graph.Count() <= max_position, "The graph has too many jobs to order, the ones after the first {} will share a key", max_position );
+
+	m_readyJobs.clear();
+	for ( u32 job_index = 0; job_index < graph.Count(); ++job_index )
+	{
+		IJob& job = *graph.m_jobs[ job_index ];
+		job.orderKey = run_order_key | ( u64( std::min( job_index + 1, max_position ) ) << 32 );
+		job.orderKeyBits = 32;
+
+		job.remainingDependencies.store( job.dependencyCount, std::memory_order_relaxed );
+		if ( !job.dependencyCount )
+			m_readyJobs.push_back( &job );
+	}
+
+	m_unfinishedJobs.store( graph.Count(), std::memory_order_release );
+
+	// deal the jobs that are ready straight away out between the workers, the longest chains go first
+	// each deque gets its jobs shortest first, so that the last one pushed, which is the first one popped, is the longest
+	// with no workers, the only deque is the waiting thread's, and they get run here and now
+	std::stable_sort( m_readyJobs.begin(), m_readyJobs.end(), []( const IJob* lhs, const IJob* rhs ) { return lhs->criticalPathTime > rhs->criticalPathTime; } );
+
+	const u32 deque_count = std::max< u32 >( GetWorkerCount(), 1 );
+	const u32 ready_count = u32( m_readyJobs.size() );
+
+	for ( u32 ready_index = ready_count; ready_index-- > 0; )
+		m_deques[ ready_index % deque_count ]->Push( m_readyJobs[ ready_index ] );
+
+	if ( !WEAK_ASSERT( ready_count, "None of the {} jobs can start, their dependencies must be circular", graph.Count() ) )
+		m_unfinishedJobs = 0;
+
+	if ( m_workers.empty() )
+	{
+		while ( IJob* const job = m_deques[ 0 ]->Pop() )
+			RunJob( *job, 0 );
+
+		return;
+	}
+
+	WakeWorkers( ready_count );
 }
 
 void WorkerPool::Wait()
 {
 	ZoneScoped;
 
-	while ( m_activeWorkers < m_workersCanStart );
-	m_workersCanStart = 0;
+	const u32 waiter_index = GetWorkerCount();
+
+	// help out with any jobs that are ready, and spin for a bit when there aren't any, frames are often short
+	for ( u32 spin = 0; spin < m_maxSpinCount && m_unfinishedJobs.load( std::memory_order_acquire ) > 0; )
+	{
+		if ( m_helpWhileWaiting )
+		{
+			if ( IJob* const job = FindJob( waiter_index ) )
+			{
+				RunJob( *job, waiter_index );
+				spin = 0;
+				continue;
+			}
+
+			if ( std::unique_ptr< ITask > task = FindTask( TaskPriority::FrameCritical ) )
+			{
+				RunTask( std::move( task ), waiter_index );
+				spin = 0;
+				continue;
+			}
+		}
+
+		++spin;
+		std::this_thread::yield();
+	}
+
+	// the last job to finish wakes us up
+	while ( const u32 unfinished_jobs = m_unfinishedJobs.load( std::memory_order_acquire ) )
+		m_unfinishedJobs.wait( unfinished_jobs, std::memory_order_acquire );
+}
+
+u32 WorkerPool::GetCurrentThreadIndex() const
+{
+	return s_workerPool == this ? s_workerIndex : GetWorkerCount();
+}
+
+const IJob* WorkerPool::GetCurrentJob()
+{
+	return s_currentJob;
+}
+
+u64 WorkerPool::GetCurrentOrderKey() const
+{
+	if ( s_currentJob )
+		return s_currentJob->orderKey;
+
+	// the latest run with all of the bits below it set, anything that starts a run after this gets a later key
+	const u64 run_order_key = u64( m_runCount.load() ) << IJob::c_orderKeyRunShift;
+	return run_order_key | ( ( u64( 1 ) << IJob::c_orderKeyRunShift ) - 1 );
+}
+
+void WorkerPool::RunAndWait( std::span< IJob* const > jobs )
+{
+	ZoneScoped;
+
+	if ( jobs.empty() )
+		return;
+
+	// threads that aren't our workers share the waiting thread's deque
+	const u32 index = GetCurrentThreadIndex();
+	// the jobs' positions go in the bits below the ones the parent's key uses, leaving 0 for the parent itself
+	// called from outside of a job, it starts a run of its own
+	const u64 parent_order_key = s_currentJob ? s_currentJob->orderKey : StartRun();
+	const u32 parent_order_key_bits = s_currentJob ? s_currentJob->orderKeyBits : 32;
+	const u32 order_key_bits = parent_order_key_bits + u32( std::bit_width( jobs.size() ) );
+
+	const bool order_keys_fit = WEAK_ASSERT_ONCE( order_key_bits <= 64, "RunAndWait is nested too deeply to order its jobs, they'll share their parent's order key" );
+
+	// these are counted here rather than in m_unfinishedJobs, so Wait and IsFrameInFlight only see the frame's jobs
+	std::atomic_uint32_t unfinished_jobs = u32( jobs.size() );
+
+	for ( IJob* const& job : jobs )
+	{
+#		if _DEBUG
+		STRONG_ASSERT( !job->dependencyCount && job->successors.empty(), "Jobs passed to RunAndWait can't have dependencies" );
+#		endif
+
+		job->forkCounter = &unfinished_jobs;
+		job->orderKey = order_keys_fit ? parent_order_key | ( u64( &job - jobs.data() + 1 ) << ( 64 - order_key_bits ) ) : parent_order_key;
+		job->orderKeyBits = order_keys_fit ? order_key_bits : parent_order_key_bits;
+		m_deques[ index ]->Push( job );
+	}
+
+	// we'll take one of them ourselves
+	WakeWorkers( u32( jobs.size() ) - 1 );
+
+	// help out like Wait does, running any jobs that are ready, and spinning for a bit when there aren't any
+	for ( u32 spin = 0; spin < m_maxSpinCount && unfinished_jobs.load( std::memory_order_acquire ) > 0; )
+	{
+		if ( IJob* const job = FindJob( index ) )
+		{
+			RunJob( *job, index );
+			spin = 0;
+			continue;
+		}
+
+		++spin;
+		std::this_thread::yield();
+	}
+
+	// then sleep until the last of them finishes and wakes us up
+	while ( const u32 remaining_jobs = unfinished_jobs.load( std::memory_order_acquire ) )
+		unfinished_jobs.wait( remaining_jobs, std::memory_order_acquire );
+}
+
+void WorkerPool::SubmitTask( std::unique_ptr< ITask > task )
+{
+	// with no workers there's nobody to hand it to, so it runs here and now
+	if ( m_workers.empty() || ( task->priority == TaskPriority::Background && !CanSpareWorkerForBackgroundTasks() ) )
+	{
+		m_runningTasks.fetch_add( 1 );
+		RunTask( std::move( task ), GetWorkerCount() );
+		return;
+	}
+
+	{
+		std::lock_guard lock( m_taskMutex );
+		m_tasks[ u32( task->priority ) ].push_back( std::move( task ) );
+		m_pendingTasks.fetch_add( 1 );
+	}
+
+	WakeWorkers( 1 );
+}
+
+void WorkerPool::RunTaskCallbacks()
+{
+	ZoneScoped;
+
+	std::vector< std::unique_ptr< ITask > > finished_tasks;
+	{
+		std::lock_guard lock( m_taskMutex );
+		finished_tasks.swap( m_finishedTasks );
+	}
+
+	for ( auto& task : finished_tasks )
+		task->Complete();
+}
+
+std::unique_ptr< ITask > WorkerPool::FindTask( TaskPriority lowest_priority )
+{
+	if ( !m_pendingTasks.load() )
+		return nullptr;
+
+	std::lock_guard lock( m_taskMutex );
+	for ( u32 priority = 0; priority <= u32( lowest_priority ); ++priority )
+	{
+		auto& tasks = m_tasks[ priority ];
+		if ( tasks.empty() )
+			continue;
+
+		// background tasks wait for the frame to finish, and leave a worker free for the next one
+		if ( priority == u32( TaskPriority::Background ) )
+		{
+			const u32 max_background_tasks = GetWorkerCount() - 1;
+			if ( m_unfinishedJobs.load() || m_runningBackgroundTasks >= max_background_tasks )
+				break;
+
+			++m_runningBackgroundTasks;
+		}
+
+		std::unique_ptr< ITask > task = std::move( tasks.front() );
+		tasks.pop_front();
+
+		m_pendingTasks.fetch_sub( 1 );
+		m_runningTasks.fetch_add( 1 );
+		return task;
+	}
+
+	return nullptr;
+}
+
+void WorkerPool::RunTask( std::unique_ptr< ITask > task, u32 index )
+{
+	ZoneScoped;
+
+	WorkerCounters& counters = *m_counters[ index ];
+	const u64 start_time = GetNanoseconds();
+
+	const IJob* const parent_job = std::exchange( s_currentJob, nullptr );
+	task->Run();
+	s_currentJob = parent_job;
+
+	counters.busyTime.fetch_add( GetNanoseconds() - start_time, std::memory_order_relaxed );
+	counters.tasksRun.fetch_add( 1, std::memory_order_relaxed );
+
+	{
+		std::lock_guard lock( m_taskMutex );
+
+		// the ones run by SubmitTask weren't counted
+		if ( task->priority == TaskPriority::Background && CanSpareWorkerForBackgroundTasks() )
+			--m_runningBackgroundTasks;
+
+		if ( task->HasCallback() )
+			m_finishedTasks.push_back( std::move( task ) );
+	}
+
+	m_runningTasks.fetch_sub( 1 );
+}
+
+void WorkerPool::WakeWorkers( u32 job_count )
+{
+	if ( !job_count || !m_sleepingWorkers.load() )
+		return;
+
+	m_lastWakeTime.store( GetNanoseconds(), std::memory_order_relaxed );
+	m_workEpoch.fetch_add( 1 );
+
+	if ( job_count == 1 )
+		m_workEpoch.notify_one();
+	else
+		m_workEpoch.notify_all();
+}
+
+WorkerPool::Stats WorkerPool::GetStats() const
+{
+	Stats stats;
+
+	for ( const auto& counters : m_counters )
+	{
+		stats.jobsRun += counters->jobsRun.load( std::memory_order_relaxed );
+		stats.tasksRun += counters->tasksRun.load( std::memory_order_relaxed );
+		stats.busyTime += counters->busyTime.load( std::memory_order_relaxed );
+		stats.spinTime += counters->spinTime.load( std::memory_order_relaxed );
+		stats.sleepTime += counters->sleepTime.load( std::memory_order_relaxed );
+		stats.wakeUps += counters->wakeUps.load( std::memory_order_relaxed );
+		stats.totalWakeLatency += counters->totalWakeLatency.load( std::memory_order_relaxed );
+		stats.maxWakeLatency = std::max< u64 >( stats.maxWakeLatency, counters->maxWakeLatency.load( std::memory_order_relaxed ) );
+	}
 
-	while ( m_activeWorkers > 0 );
+	return stats;
 }
 
-void WorkerPool::Worker( u32 index, u32 count )
+void WorkerPool::ResetStats()
+{
+	for ( auto& counters : m_counters )
+	{
+		counters->jobsRun = 0;
+		counters->tasksRun = 0;
+		counters->busyTime = 0;
+		counters->spinTime = 0;
+		counters->sleepTime = 0;
+		counters->wakeUps = 0;
+		counters->totalWakeLatency = 0;
+		counters->maxWakeLatency = 0;
+	}
+}
+
+f32 WorkerPool::Stats::GetUtilisation() const
+{
+	const u64 total_time = busyTime + spinTime + sleepTime;
+	return total_time ? f32( busyTime ) / f32( total_time ) : 0.f;
+}
+
+f32 WorkerPool::Stats::GetCPUUtilisation() const
+{
+	const u64 total_time = busyTime + spinTime + sleepTime;
+	return total_time ? f32( busyTime + spinTime ) / f32( total_time ) : 0.f;
+}
+
+IJob* WorkerPool::FindJob( u32 index )
+{
+	if ( IJob* const job = m_deques[ index ]->Pop() )
+		return job;
+
+	for ( u32 offset = 1; offset < m_deques.size(); ++offset )
+		if ( IJob* const job = m_deques[ ( index + offset ) % m_deques.size() ]->Steal() )
+			return job;
+
+	return nullptr;
+}
+
+void WorkerPool::RunJob( IJob& job, u32 index )
+{
+	WorkerCounters& counters = *m_counters[ index ];
+	const u64 start_time = GetNanoseconds();
+
+	// RunAndWait can run other jobs on this thread while this one waits
+	const IJob* const parent_job = std::exchange( s_currentJob, &job );
+	job.Run();
+	s_currentJob = parent_job;
+
+	// a job only runs on one thread at a time, and its times are only read between Wait and Begin
+	const u64 time = GetNanoseconds() - start_time;
+	job.lastTime = time;
+	job.averageTime = job.averageTime ? ( job.averageTime * 7 + time ) / 8 : time;
+
+	counters.busyTime.fetch_add( time, std::memory_order_relaxed );
+	counters.jobsRun.fetch_add( 1, std::memory_order_relaxed );
+
+	// successors go on our own deque, they probably want the same data this job just used
+	u32 ready_count = 0;
+	for ( IJob* successor : job.successors )
+	{
+		if ( successor->remainingDependencies.fetch_sub( 1, std::memory_order_acq_rel ) == 1 )
+		{
+			m_deques[ index ]->Push( successor );
+			++ready_count;
+		}
+	}
+
+	// we'll take one of them ourselves
+	if ( ready_count > 1 )
+		WakeWorkers( ready_count - 1 );
+
+	// RunAndWait may return as soon as this hits zero, so the job can't be touched after it
+	// the notify only hands the counter's address to the OS to find who's waiting on it, like std::latch does, so it's fine if it's gone by then
+	if ( std::atomic_uint32_t* const fork_counter = job.forkCounter )
+	{
+		job.forkCounter = nullptr;
+		if ( fork_counter->fetch_sub( 1, std::memory_order_acq_rel ) == 1 )
+			fork_counter->notify_one();
+
+		return;
+	}
+
+	if ( m_unfinishedJobs.fetch_sub( 1 ) == 1 )
+	{
+		m_unfinishedJobs.notify_all();
+
+		// background tasks that were held back for the frame can start now
+		WakeWorkers( m_pendingTasks.load() );
+	}
+}
+
+void WorkerPool::Worker( u32 index )
 {
 #ifdef _WIN32
 	{
@@ -129,24 +656,90 @@ void WorkerPool::Worker( u32 index, u32 count )
 	}
 #endif
 
+	s_workerPool = this;
+	s_workerIndex = index;
+
+	WorkerCounters& counters = *m_counters[ index ];
+	u32 spin_count = c_minSpinCount;
+
 	while ( !m_workersShouldStop )
 	{
-		if ( index >= m_workersCanStart )
+		if ( IJob* const job = FindJob( index ) )
+		{
+			RunJob( *job, index );
+			continue;
+		}
+
+		// tasks only get a look in once the frame jobs have run out
+		if ( std::unique_ptr< ITask > task = FindTask( TaskPriority::Background ) )
+		{
+			RunTask( std::move( task ), index );
+			continue;
+		}
+
+		// new jobs often turn up within a few microseconds, so spin for a bit first
+		IJob* job = nullptr;
+		std::unique_ptr< ITask > task = nullptr;
+		const u64 spin_start = GetNanoseconds();
+
+		for ( u32 spin = 0; spin < spin_count && !job && !task && !m_workersShouldStop; ++spin )
 		{
 			std::this_thread::yield();
+
+			job = FindJob( index );
+			if ( !job )
+				task = FindTask( TaskPriority::Background );
+		}
+
+		counters.spinTime.fetch_add( GetNanoseconds() - spin_start, std::memory_order_relaxed );
+
+		// spin for longer next time if it paid off, and for less time if it didn't
+		if ( job || task )
+		{
+			spin_count = std::min< u32 >( spin_count * 2, m_maxSpinCount );
+
+			if ( job )
+				RunJob( *job, index );
+			else
+				RunTask( std::move( task ), index );
+
 			continue;
 		}
-		
-		TracyMessageL( "Woke up" );
-		m_activeWorkers++;
 
-		while ( m_jobQueue.StartNextAvailableJob() );
+		spin_count = std::max( spin_count / 2, c_minSpinCount );
+
+		// announce we're going to sleep before the last look for a job
+		// so anybody pushing a job after we've looked knows to wake us up
+		m_sleepingWorkers.fetch_add( 1 );
+		const u32 epoch = m_workEpoch.load();
+
+		job = FindJob( index );
+		if ( !job )
+			task = FindTask( TaskPriority::Background );
+
+		if ( !job && !task && !m_workersShouldStop )
+		{
+			TracyMessageL( "Going to sleep" );
+			const u64 sleep_start = GetNanoseconds();
+
+			m_workEpoch.wait( epoch );
+
+			const u64 wake_time = GetNanoseconds();
+			const u64 wake_latency = wake_time - std::min< u64 >( wake_time, m_lastWakeTime.load( std::memory_order_relaxed ) );
+
+			counters.sleepTime.fetch_add( wake_time - sleep_start, std::memory_order_relaxed );
+			counters.wakeUps.fetch_add( 1, std::memory_order_relaxed );
+			counters.totalWakeLatency.fetch_add( wake_latency, std::memory_order_relaxed );
+			counters.maxWakeLatency.store( std::max< u64 >( counters.maxWakeLatency.load( std::memory_order_relaxed ), wake_latency ), std::memory_order_relaxed );
+			TracyMessageL( "Woke up" );
+		}
 
-		TracyMessageL( "Ready to sleep" );
-		while ( index < m_workersCanStart ) std::this_thread::yield();
+		m_sleepingWorkers.fetch_sub( 1 );
 
-		TracyMessageL( "Back to sleep" );
-		m_activeWorkers--;
+		if ( job )
+			RunJob( *job, index );
+		else if ( task )
+			RunTask( std::move( task ), index );
 	}
 }
 
@@ -6,6 +6,13 @@
 #include <thread>
 #include <mutex>
 #include <shared_mutex>
+#include <atomic>
+#include <span>
+#include <deque>
+#include <future>
+#include <optional>
+#include <variant>
+#include <string>
 
 namespace onyx
 {
@@ -14,58 +21,381 @@ struct IJob
 {
 	virtual ~IJob() = default;
 
-	virtual bool TryLock() { return true; }
 	virtual void Run() = 0;
 
-	void AddDependency( const IJob* other_job ) { dependencies.push_back( other_job ); }
+	// this job won't start until other_job has finished
+	void AddDependency( IJob* other_job )
+	{
+		other_job->successors.push_back( this );
+		++dependencyCount;
+	}
+
+	// the jobs that depend on this one, the last of their dependencies to finish makes them ready to run
+	std::vector< IJob* > successors;
+	u32 dependencyCount = 0;
+	std::atomic_uint32_t remainingDependencies = 0;
+
+	// set by RunAndWait, counts down the jobs it's waiting for
+	std::atomic_uint32_t* forkCounter = nullptr;
+
+	// shown when the graph is exported, jobs without a name are shown by their index
+	const char* name = nullptr;
+
+	// set however the jobs get scheduled, so things they record can be put back in the order they were started in
+	// the top c_orderKeyRunBits count the graphs and top level RunAndWaits the pool has started, the next 16 are the job's position in its graph
+	// then RunAndWait puts each job's position in a field just below its parent's
+	// so a forked job comes after its parent, and before its parent's later siblings and all of their forks
+	// the run count wraps around, so compare keys with IsOrderedBefore
+	u64 orderKey = 0;
+
+	// how many bits of orderKey, from the top, are taken by the run, the graph and the RunAndWaits this job was forked from
+	u32 orderKeyBits = 32;
 
-	std::vector< const IJob* > dependencies;
-	std::atomic_bool hasStarted = false;
-	bool hasFinished = false;
+	constexpr static u32 c_orderKeyRunBits = 16;
+	constexpr static u32 c_orderKeyRunShift = 64 - c_orderKeyRunBits;
+
+	// keys are compared by how far apart they are rather than by value, so the run count can wrap
+	// that works as long as the keys being compared come from runs less than 2^15 apart, far more than a frame starts
+	static bool IsOrderedBefore( u64 lhs, u64 rhs ) { return i64( lhs - rhs ) < 0; }
+
+	// measured by the pool each time the job runs, in nanoseconds
+	u64 lastTime = 0;
+	u64 averageTime = 0;
+
+	// the longest chain of average times from the start of this job to the end of its graph, worked out when the graph begins
+	u64 criticalPathTime = 0;
 };
 
-struct JobQueue
+// a set of jobs and the dependencies between them
+// the dependencies live in the jobs and their counters are reset each time the graph begins
+// so a graph that doesn't change can be built once and run over and over without allocating
+struct JobGraph
 {
 	void Reserve( u32 num_jobs ) { m_jobs.reserve( num_jobs ); }
 
 	template< typename Job, typename ... Args >
-	void AddJob( u64 id, Args& ... args )
+	Job& AddJob( Args&& ... args )
 	{
-		m_jobs.insert( { id, std::make_unique< Job >( args ... ) } );
+		return static_cast< Job& >( *m_jobs.emplace_back( std::make_unique< Job >( std::forward< Args >( args ) ... ) ) );
 	}
 
-	IJob* GetNextJob( bool& any_unstarted_jobs );
-	bool StartNextAvailableJob();
 	void Reset() { m_jobs.clear(); }
-	u32 Count() const { return m_jobs.size(); }
+
+	u32 Count() const { return u32( m_jobs.size() ); }
+
+	// the longest chain of average job times through the graph, as of the last time it began
+	// with enough workers, the graph can't finish any sooner than this
+	u64 GetCriticalPathTime() const { return m_criticalPathTime; }
+
+	// the jobs and their dependencies, with the times measured so far and the critical path highlighted
+	std::string ExportDOT() const;
+	std::string ExportJSON() const;
+
+private:
+	friend struct WorkerPool;
+
+	// in the order they were added
+	std::vector< std::unique_ptr< IJob > > m_jobs;
+
+	// the jobs ordered so that each one comes after its dependencies, kept around so it doesn't need reallocating
+	std::vector< IJob* > m_order;
+	u64 m_criticalPathTime = 0;
+
+	void UpdateCriticalPath();
+
+	// follows the longest chain from the job that starts it
+	std::vector< const IJob* > GetCriticalPath() const;
+};
+
+// a job graph that gets rebuilt every time it runs, with ids to find jobs by while setting up dependencies
+struct JobQueue : JobGraph
+{
+	void Reserve( u32 num_jobs )
+	{
+		JobGraph::Reserve( num_jobs );
+		m_jobIDs.reserve( num_jobs );
+	}
+
+	template< typename Job, typename ... Args >
+	void AddJob( u64 id, Args& ... args )
+	{
+		m_jobIDs.insert( { id, &JobGraph::AddJob< Job >( args ... ) } );
+	}
+
+	void Reset()
+	{
+		JobGraph::Reset();
+		m_jobIDs.clear();
+	}
 
 	inline IJob* GetJob( u64 id )
 	{
-		auto iter = m_jobs.find( id );
-		return iter == m_jobs.end() ? nullptr : iter->second.get();
+		auto iter = m_jobIDs.find( id );
+		return iter == m_jobIDs.end() ? nullptr : iter->second;
 	}
 
 private:
-	std::unordered_map< u64, std::unique_ptr< IJob > > m_jobs;
+	std::unordered_map< u64, IJob* > m_jobIDs;
+};
+
+// tasks are separate from the per-frame jobs, they can be submitted at any time and can take as long as they like
+// Wait doesn't wait for them, submit them with a future or a callback to find out when they're done
+enum class TaskPriority : u8
+{
+	// taken ahead of the other tasks, the thread waiting on the frame helps with these
+	FrameCritical,
+
+	// taken whenever a worker runs out of frame jobs
+	Normal,
+
+	// only started between frames, and never on every worker at once, so a frame always has a worker to itself
+	// a pool with fewer than two workers can't spare one, so it runs them on the submitting thread instead
+	Background,
+
+	Count,
+};
+
+struct ITask
+{
+	virtual ~ITask() = default;
+
+	virtual void Run() = 0;
+
+	// called by RunTaskCallbacks, after Run has finished
+	virtual void Complete() {}
+	virtual bool HasCallback() const { return false; }
+
+	TaskPriority priority = TaskPriority::Normal;
+};
+
+template< typename Func >
+struct FutureTask : ITask
+{
+	using Result = std::invoke_result_t< Func& >;
+
+	FutureTask( Func&& func ) : m_func( std::move( func ) ) {}
+
+	void Run() override
+	{
+		if constexpr ( std::is_void_v< Result > )
+		{
+			m_func();
+			m_promise.set_value();
+		}
+		else
+			m_promise.set_value( m_func() );
+	}
+
+	Func m_func;
+	std::promise< Result > m_promise;
 };
 
+template< typename Func, typename Callback >
+struct CallbackTask : ITask
+{
+	using Result = std::invoke_result_t< Func& >;
+
+	CallbackTask( Func&& func, Callback&& callback ) : m_func( std::move( func ) ), m_callback( std::move( callback ) ) {}
+
+	void Run() override
+	{
+		if constexpr ( std::is_void_v< Result > )
+			m_func();
+		else
+			m_result.emplace( m_func() );
+	}
+
+	void Complete() override
+	{
+		if constexpr ( std::is_void_v< Result > )
+			m_callback();
+		else
+			m_callback( std::move( *m_result ) );
+	}
+
+	bool HasCallback() const override { return true; }
+
+	Func m_func;
+	Callback m_callback;
+	std::optional< std::conditional_t< std::is_void_v< Result >, std::monostate, Result > > m_result;
+};
+
+// the jobs that are ready to go when a graph begins are started longest critical path first, going by the times they took before
+// each worker has its own deque of ready jobs, it takes the newest jobs from its own deque
+// and when that runs dry, it steals the oldest jobs from the others
+// idle workers spin for a while in case more work turns up, then sleep until it does
+// a thread waiting on the pool can also run jobs, so it isn't sitting idle, only one thread should wait at a time
+// workers with no frame jobs left run tasks, most important first
 struct WorkerPool
 {
-	WorkerPool( u32 num_workers = UINT32_MAX );
+	WorkerPool( u32 num_workers = UINT32_MAX, bool help_while_waiting = true );
 	~WorkerPool();
 
 	JobQueue& GetJobQueue();
-	void Begin();
+	void Begin() { Begin( m_jobQueue ); }
 	void Wait();
 
+	// waits for anything already running, then starts the graph's jobs
+	// the graph has to outlive the jobs, i.e. until the next Wait
+	void Begin( JobGraph& graph );
+
+	// runs the jobs on the pool and returns once they've all finished, so that a job can split itself up
+	// the calling thread runs jobs while it waits, which may include jobs that have nothing to do with these ones
+	// once there are none left to run, it spins for a while like Wait does, then sleeps until the last of its jobs finishes
+	// the jobs mustn't have any dependencies
+	void RunAndWait( std::span< IJob* const > jobs );
+
+	u32 GetWorkerCount() const { return u32( m_workers.size() ); }
+
+	// the index of the calling worker, threads that aren't workers all get GetWorkerCount()
+	u32 GetCurrentThreadIndex() const;
+
+	// the job running on the calling thread, if any
+	static const IJob* GetCurrentJob();
+
+	// the order key of the job running on the calling thread
+	// threads that aren't running one get a key after everything from the graphs and RunAndWaits started so far
+	u64 GetCurrentOrderKey() const;
+
+	// queues func to run on a worker, the future is ready once it has
+	template< typename Func >
+	std::future< std::invoke_result_t< std::decay_t< Func >& > > Submit( TaskPriority priority, Func&& func )
+	{
+		auto task = std::make_unique< FutureTask< std::decay_t< Func > > >( std::forward< Func >( func ) );
+		auto future = task->m_promise.get_future();
+
+		task->priority = priority;
+		SubmitTask( std::move( task ) );
+		return future;
+	}
+
+	// queues func to run on a worker, then callback( result ) runs during the next RunTaskCallbacks after it has
+	template< typename Func, typename Callback >
+	void Submit( TaskPriority priority, Func&& func, Callback&& callback )
+	{
+		auto task = std::make_unique< CallbackTask< std::decay_t< Func >, std::decay_t< Callback > > >( std::forward< Func >( func ), std::forward< Callback >( callback ) );
+
+		task->priority = priority;
+		SubmitTask( std::move( task ) );
+	}
+
+	void SubmitTask( std::unique_ptr< ITask > task );
+
+	// runs the callbacks of the tasks that have finished, on the calling thread, usually the main thread once a frame
+	void RunTaskCallbacks();
+
+	// the tasks that haven't started yet
+	u32 GetPendingTaskCount() const { return m_pendingTasks.load( std::memory_order_relaxed ); }
+
+	// long background tasks can check this to break themselves up while a frame is running
+	// jobs started by RunAndWait outside of a frame, e.g. from a task, don't count
+	bool IsFrameInFlight() const { return m_unfinishedJobs.load( std::memory_order_relaxed ) > 0; }
+
+	// summed over all of the workers and the waiting thread, times are in nanoseconds
+	struct Stats
+	{
+		u64 jobsRun = 0;
+		u64 tasksRun = 0;
+		u64 busyTime = 0;
+		u64 spinTime = 0;
+		u64 sleepTime = 0;
+		u64 wakeUps = 0;
+		u64 totalWakeLatency = 0;
+		u64 maxWakeLatency = 0;
+
+		// the fraction of the workers' time spent running jobs
+		f32 GetUtilisation() const;
+
+		// the fraction of the workers' time spent awake, running jobs or spinning
+		f32 GetCPUUtilisation() const;
+
+		f32 GetAverageWakeLatency() const { return wakeUps ? f32( totalWakeLatency ) / f32( wakeUps ) : 0.f; }
+	};
+
+	Stats GetStats() const;
+	void ResetStats();
+
+	// idle workers spin for somewhere between c_minSpinCount and this many tries before they go to sleep
+	// the more often spinning finds a job, the longer they spin for
+	void SetMaxSpinCount( u32 spin_count ) { m_maxSpinCount = std::max( spin_count, c_minSpinCount ); }
+
 private:
+	constexpr static u32 c_minSpinCount = 16;
+	constexpr static u32 c_defaultMaxSpinCount = 1024;
+
+	struct alignas( 64 ) WorkDeque
+	{
+		void Push( IJob* job );
+		IJob* Pop();
+		IJob* Steal();
+
+	private:
+		std::mutex m_mutex;
+		std::vector< IJob* > m_jobs;
+
+		// jobs before this have been stolen
+		size_t m_head = 0;
+	};
+
 	std::vector< std::jthread > m_workers;
 	JobQueue m_jobQueue;
-	std::atomic_uint32_t m_activeWorkers = 0;
-	u32 m_workersCanStart = 0;
-	bool m_workersShouldStop = false;
 
-	void Worker( u32 index, u32 count );
+	// scratch space for Begin
+	std::vector< IJob* > m_readyJobs;
+
+	// one per worker, plus one at the end for the thread that waits on the pool
+	std::vector< std::unique_ptr< WorkDeque > > m_deques;
+
+	struct alignas( 64 ) WorkerCounters
+	{
+		std::atomic< u64 > jobsRun = 0;
+		std::atomic< u64 > tasksRun = 0;
+		std::atomic< u64 > busyTime = 0;
+		std::atomic< u64 > spinTime = 0;
+		std::atomic< u64 > sleepTime = 0;
+		std::atomic< u64 > wakeUps = 0;
+		std::atomic< u64 > totalWakeLatency = 0;
+		std::atomic< u64 > maxWakeLatency = 0;
+	};
+
+	// one per worker, plus the waiting thread, only written by that thread
+	std::vector< std::unique_ptr< WorkerCounters > > m_counters;
+
+	const bool m_helpWhileWaiting = true;
+
+	// the jobs from the graph passed to Begin that haven't finished yet, RunAndWait counts its own jobs
+	std::atomic_uint32_t m_unfinishedJobs = 0;
+
+	// bumped each time a graph begins or RunAndWait is called from outside of a job, it goes in the top of their jobs' order keys
+	std::atomic_uint32_t m_runCount = 0;
+	std::atomic_bool m_workersShouldStop = false;
+
+	// sleeping workers wait for this to change, it's bumped whenever jobs are pushed while anybody is asleep
+	std::atomic_uint32_t m_workEpoch = 0;
+	std::atomic_uint32_t m_sleepingWorkers = 0;
+	std::atomic< u64 > m_lastWakeTime = 0;
+	std::atomic_uint32_t m_maxSpinCount = c_defaultMaxSpinCount;
+
+	// one queue per priority, oldest first
+	std::mutex m_taskMutex;
+	std::deque< std::unique_ptr< ITask > > m_tasks[ u32( TaskPriority::Count ) ];
+	std::vector< std::unique_ptr< ITask > > m_finishedTasks;
+	std::atomic_uint32_t m_pendingTasks = 0;
+	std::atomic_uint32_t m_runningTasks = 0;
+	u32 m_runningBackgroundTasks = 0;
+
+	// the top of the order keys for a new run
+	u64 StartRun() { return u64( m_runCount.fetch_add( 1 ) + 1 ) << IJob::c_orderKeyRunShift; }
+
+	void Worker( u32 index );
+	IJob* FindJob( u32 index );
+	void RunJob( IJob& job, u32 index );
+
+	// takes the most important task that's allowed to start, no less important than lowest_priority
+	std::unique_ptr< ITask > FindTask( TaskPriority lowest_priority );
+	bool CanSpareWorkerForBackgroundTasks() const { return GetWorkerCount() > 1; }
+	void RunTask( std::unique_ptr< ITask > task, u32 index );
+	void WakeWorkers( u32 job_count );
 };
 
 namespace LowLevel
@@ -0,0 +1,237 @@
+#pragma once
+
+#include "Multithreading.h"
+
+#include <algorithm>
+#include <deque>
+#include <iterator>
+#include <span>
+#include <vector>
+
+namespace onyx
+{
+
+// data parallel loops on the worker pool
+// they're built on WorkerPool::RunAndWait, so they can be called from inside a running job, including from each other
+// the work is split into chunks of at least grain_size, ranges smaller than that run on the calling thread
+
+constexpr static u32 c_defaultGrainSize = 1024;
+
+// the jobs ParallelForChunks runs, func is type erased so the jobs can be kept and reused whatever it's called with
+struct ParallelChunkJob : IJob
+{
+	void Run() override { m_run( m_func, m_chunkIndex ); }
+
+	void( *m_run )( const void* func, u32 chunk_index ) = nullptr;
+	const void* m_func = nullptr;
+	u32 m_chunkIndex = 0;
+};
+
+// each thread keeps its chunk jobs from call to call, so the loops that run every frame don't allocate
+// a job the thread runs while it waits can make a call of its own, so there's a set for each level of nesting
+// they're in deques so that adding to them never moves the jobs, or the sets the calls further out are using
+struct ParallelChunkJobs
+{
+	std::deque< ParallelChunkJob > jobs;
+	std::vector< IJob* > jobPtrs;
+};
+
+inline thread_local std::deque< ParallelChunkJobs > s_parallelChunkJobs;
+inline thread_local u32 s_parallelChunkDepth = 0;
+
+// calls func( chunk_index ) for each chunk, on the pool, and returns when they've all finished
+template< typename Func >
+void ParallelForChunks( u32 chunk_count, const Func& func )
+{
+	if ( chunk_count <= 1 )
+	{
+		if ( chunk_count )
+			func( 0u );
+
+		return;
+	}
+
+	if ( s_parallelChunkJobs.size() == s_parallelChunkDepth )
+		s_parallelChunkJobs.emplace_back();
+
+	ParallelChunkJobs& chunk_jobs = s_parallelChunkJobs[ s_parallelChunkDepth++ ];
+
+	while ( chunk_jobs.jobs.size() < chunk_count )
+		chunk_jobs.jobs.emplace_back();
+
+	chunk_jobs.jobPtrs.clear();
+	for ( u32 chunk_index = 0; chunk_index < chunk_count; ++chunk_index )
+	{
+		ParallelChunkJob& job = chunk_jobs.jobs[ chunk_index ];
+		job.m_run = []( const void* func, u32 chunk_index ) { ( *static_cast< const Func* >( func ) )( chunk_index ); };
+		job.m_func = &func;
+		job.m_chunkIndex = chunk_index;
+		chunk_jobs.jobPtrs.push_back( &job );
+	}
+
+	onyx::LowLevel::GetWorkerPool().RunAndWait( chunk_jobs.jobPtrs );
+
+	--s_parallelChunkDepth;
+}
+
+// calls func( index ) for every index in [begin, end)
+template< typename Func >
+void ParallelFor( u32 begin, u32 end, const Func& func, u32 grain_size = c_defaultGrainSize )
+{
+	if ( end <= begin )
+		return;
+
+	// a few chunks per thread is enough to balance the load, any more is just overhead
+	const u32 count = end - begin;
+	const u32 max_chunks = ( onyx::LowLevel::GetWorkerPool().GetWorkerCount() + 1 ) * 4;
+	const u32 chunk_count = std::clamp( count / std::max( grain_size, 1u ), 1u, max_chunks );
+
+	ParallelForChunks( chunk_count, [&]( u32 chunk_index ) {
+		const u32 chunk_begin = begin + u32( u64( count ) * chunk_index / chunk_count );
+		const u32 chunk_end = begin + u32( u64( count ) * ( chunk_index + 1 ) / chunk_count );
+
+		for ( u32 index = chunk_begin; index < chunk_end; ++index )
+			func( index );
+	} );
+}
+
+// combines func( index ) for every index in [begin, end), starting from identity
+// the chunks only depend on the range and the grain size, and are combined in order
+// so the result is the same from run to run and machine to machine, even for floats
+// several chunks may share a job, so the grain size can be small without making lots of jobs
+template< typename T, typename Func, typename Combine >
+T ParallelReduce( u32 begin, u32 end, const T& identity, const Func& func, const Combine& combine, u32 grain_size = c_defaultGrainSize )
+{
+	if ( end <= begin )
+		return identity;
+
+	const u32 count = end - begin;
+	grain_size = std::max( grain_size, 1u );
+	const u32 chunk_count = ( count + grain_size - 1 ) / grain_size;
+
+	std::vector< T > partials( chunk_count, identity );
+
+	ParallelFor( 0, chunk_count, [&]( u32 chunk_index ) {
+		const u32 chunk_begin = begin + chunk_index * grain_size;
+		const u32 chunk_end = std::min( chunk_begin + grain_size, end );
+
+		T partial = identity;
+		for ( u32 index = chunk_begin; index < chunk_end; ++index )
+			partial = combine( partial, func( index ) );
+
+		partials[ chunk_index ] = std::move( partial );
+	}, 1 );
+
+	T result = identity;
+	for ( T& partial : partials )
+		result = combine( result, partial );
+
+	return result;
+}
+
+// output[ i ] = combine( input[ 0 ], ... input[ i ] ), input and output can be the same
+// like ParallelReduce, the chunks only depend on the size and the grain size
+template< typename T, typename Combine >
+void ParallelInclusiveScan( std::span< const T > input, std::span< T > output, const T& identity, const Combine& combine, u32 grain_size = c_defaultGrainSize )
+{
+	const u32 count = u32( std::min( input.size(), output.size() ) );
+	if ( !count )
+		return;
+
+	grain_size = std::max( grain_size, 1u );
+	const u32 chunk_count = ( count + grain_size - 1 ) / grain_size;
+
+	// total up each chunk
+	std::vector< T > chunk_offsets( chunk_count, identity );
+
+	ParallelFor( 0, chunk_count, [&]( u32 chunk_index ) {
+		const u32 chunk_begin = chunk_index * grain_size;
+		const u32 chunk_end = std::min( chunk_begin + grain_size, count );
+
+		T total = identity;
+		for ( u32 index = chunk_begin; index < chunk_end; ++index )
+			total = combine( total, input[ index ] );
+
+		chunk_offsets[ chunk_index ] = std::move( total );
+	}, 1 );
+
+	// turn the totals into what comes before each chunk
+	T running_total = identity;
+	for ( T& chunk_offset : chunk_offsets )
+	{
+		T chunk_total = std::move( chunk_offset );
+		chunk_offset = running_total;
+		running_total = combine( running_total, chunk_total );
+	}
+
+	// then scan each chunk starting from its offset
+	ParallelFor( 0, chunk_count, [&]( u32 chunk_index ) {
+		const u32 chunk_begin = chunk_index * grain_size;
+		const u32 chunk_end = std::min( chunk_begin + grain_size, count );
+
+		T total = chunk_offsets[ chunk_index ];
+		for ( u32 index = chunk_begin; index < chunk_end; ++index )
+		{
+			total = combine( total, input[ index ] );
+			output[ index ] = total;
+		}
+	}, 1 );
+}
+
+// sorts each chunk, then merges pairs of runs in parallel until there's one left
+// not stable, like std::sort, and needs the values to be default constructible for the merge buffer
+template< typename RandomIt, typename Compare = std::less<> >
+void ParallelSort( RandomIt first, RandomIt last, const Compare& compare = {}, u32 grain_size = c_defaultGrainSize * 4 )
+{
+	using T = typename std::iterator_traits< RandomIt >::value_type;
+
+	const u32 count = u32( last - first );
+	const u32 max_chunks = ( onyx::LowLevel::GetWorkerPool().GetWorkerCount() + 1 ) * 4;
+	const u32 chunk_count = std::clamp( count / std::max( grain_size, 1u ), 1u, max_chunks );
+
+	if ( chunk_count == 1 )
+	{
+		std::sort( first, last, compare );
+		return;
+	}
+
+	auto chunk_start = [&]( u32 chunk_index ) { return u32( u64( count ) * std::min( chunk_index, chunk_count ) / chunk_count ); };
+
+	ParallelForChunks( chunk_count, [&]( u32 chunk_index ) {
+		std::sort( first + chunk_start( chunk_index ), first + chunk_start( chunk_index + 1 ), compare );
+	} );
+
+	std::vector< T > buffer( count );
+	bool in_buffer = false;
+
+	// each pass merges runs of run_length chunks into runs twice as long, bouncing between the range and the buffer
+	for ( u32 run_length = 1; run_length < chunk_count; run_length *= 2 )
+	{
+		const u32 merge_count = ( chunk_count + 2 * run_length - 1 ) / ( 2 * run_length );
+
+		auto merge_runs = [&]( auto source, auto destination ) {
+			ParallelForChunks( merge_count, [&]( u32 merge_index ) {
+				const u32 left = chunk_start( merge_index * 2 * run_length );
+				const u32 middle = chunk_start( merge_index * 2 * run_length + run_length );
+				const u32 right = chunk_start( ( merge_index + 1 ) * 2 * run_length );
+
+				std::merge(
+					std::make_move_iterator( source + left ), std::make_move_iterator( source + middle ),
+					std::make_move_iterator( source + middle ), std::make_move_iterator( source + right ),
+					destination + left, compare );
+			} );
+		};
+
+		if ( in_buffer )
+			merge_runs( buffer.begin(), first );
+		else
+			merge_runs( first, buffer.begin() );
+
+		in_buffer = !in_buffer;
+	}
+
+	if ( in_buffer )
+		ParallelFor( 0, count, [&]( u32 index ) { first[ index ] = std::move( buffer[ index ] ); }, c_defaultGrainSize * 16 );
+}
+
+}
@@ -0,0 +1,117 @@
+#include "Tests/TestUtils.h"
+
+#include "Onyx/ECS/World.h"
+#include "Onyx/ECS/Query.h"
+
+#include <random>
+
+using namespace onyx;
+using namespace onyx::ecs;
+
+namespace
+{
+
+struct Dense { f32 value[ 4 ]; };
+struct Common { i32 value; };
+struct Rare { i32 value; };
+
+// every entity has Dense, a quarter have Common, and one in 64 has Rare
+constexpr u32 c_entityCount = 200'000;
+constexpr u32 c_churnPerFrame = c_entityCount / 100;
+
+}
+
+COMPONENT_PAGE_SIZE( Dense, 256 );
+
+int main()
+{
+	ComponentRegistry::Register< Dense, Common, Rare >();
+	ComponentRegistry::Seal();
+
+	World world;
+	std::mt19937 rng( 7 );
+	std::vector< EntityID > entities;
+
+	for ( u32 i = 0; i < c_entityCount; ++i )
+	{
+		const EntityID entity = world.AddEntity( Dense{} );
+		entities.push_back( entity );
+
+		if ( rng() % 4 == 0 ) world.AddComponent( entity, Common{ i32( i ) } );
+		if ( rng() % 64 == 0 ) world.AddComponent( entity, Rare{ i32( i ) } );
+	}
+
+	world.CleanUpPages();
+
+	const ComponentSet all = ComponentRegistry::GetSet< Dense, Common, Rare >();
+	const ComponentSet sparse = ComponentRegistry::GetSet< Common, Rare >();
+
+	const auto churn = [ & ]
+	{
+		for ( u32 i = 0; i < c_churnPerFrame; ++i )
+		{
+			const EntityID entity = entities[ rng() % entities.size() ];
+			world.RemoveComponent< Common >( entity );
+			world.AddComponent( entity, Common{ 1 } );
+		}
+	};
+
+	volatile u64 sink = 0;
+
+	const f64 full = tests::TimeBest( [ & ] {
+		u64 count = 0;
+		for ( auto it = world.Iter( &all ); it; ++it ) count += it.Get< Common >() != nullptr;
+		sink = count;
+	} );
+
+	const f64 sparse_only = tests::TimeBest( [ & ] {
+		u64 count = 0;
+		for ( auto it = world.Iter( &sparse ); it; ++it ) count += it.Get< Rare >() != nullptr;
+		sink = count;
+	} );
+
+	const f64 join = tests::TimeBest( [ & ] {
+		u64 count = 0;
+		for ( auto it = world.Iter( &all, false, &sparse ); it; ++it ) count += it.Get< Dense >() != nullptr;
+		sink = count;
+	} );
+
+	// the dirty iteration is timed with the churn that dirtied it, so take the churn on its own back off
+	const f64 churn_only = tests::TimeBest( [ & ] { churn(); world.CleanUpPages(); } );
+	const f64 dirty = tests::TimeBest( [ & ] {
+		churn();
+		u64 count = 0;
+		for ( auto it = world.Iter( &all, true ); it; ++it ) count += it.Get< Common >() != nullptr;
+		sink = count;
+		world.CleanUpPages();
+	} ) - churn_only;
+
+	QuerySet query_set( world );
+	auto query = query_set.Get< Query< Read< Dense >, Read< Common > > >();
+	query_set.Update();
+
+	f64 query_update = 0.0;
+	constexpr u32 c_queryFrames = 20;
+	for ( u32 frame = 0; frame < c_queryFrames; ++frame )
+	{
+		for ( u32 i = 0; i < c_churnPerFrame; ++i )
+		{
+			const EntityID entity = entities[ rng() % entities.size() ];
+			world.RemoveComponent< Common >( entity );
+			if ( rng() % 2 ) world.AddComponent( entity, Common{ 1 } );
+		}
+
+		world.m_queryManager.UpdateNeedsRerun( world );
+		query_update += tests::Time( [ & ] { query_set.Update(); } );
+		world.CleanUpPages();
+	}
+
+	CHECK( query->Count() > 0 );
+
+	std::printf( "%u entities, %u changed per frame\n", c_entityCount, c_churnPerFrame );
+	std::printf( "full iteration        %8.3fms\n", full );
+	std::printf( "sparse iteration      %8.3fms\n", sparse_only );
+	std::printf( "joined iteration      %8.3fms\n", join );
+	std::printf( "dirty iteration       %8.3fms\n", dirty );
+	std::printf( "query update          %8.3fms\n", query_update / c_queryFrames );
+}
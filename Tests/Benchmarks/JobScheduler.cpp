@@ -0,0 +1,98 @@
+#include "Tests/TestUtils.h"
+
+#include <random>
+#include <thread>
+
+using namespace onyx;
+
+namespace
+{
+
+std::atomic_uint32_t s_clock = 0;
+
+// records when it ran, so dependencies can be checked afterwards
+struct TinyJob : IJob
+{
+	TinyJob( u32& order ) : m_order( order ) {}
+	void Run() override { m_order = ++s_clock; }
+
+	u32& m_order;
+};
+
+constexpr u32 c_jobCount = 5000;
+constexpr u32 c_runs = 20;
+
+}
+
+// usage: Benchmark_JobScheduler [worker count]
+int main( int argc, char** argv )
+{
+	WorkerPool pool( argc > 1 ? u32( std::atoi( argv[ 1 ] ) ) : UINT32_MAX );
+
+	// each job depends on up to three random earlier jobs
+	std::mt19937 rng( 3 );
+	std::vector< std::vector< u32 > > dependencies( c_jobCount );
+	for ( u32 job = 1; job < c_jobCount; ++job )
+		for ( u32 i = 0; i < 3; ++i )
+			if ( rng() % 2 )
+				dependencies[ job ].push_back( rng() % job );
+
+	std::vector< u32 > order( c_jobCount );
+
+	std::printf( "%u workers, %u empty jobs\n", pool.GetWorkerCount(), c_jobCount );
+
+	for ( const bool with_dependencies : { false, true } )
+	{
+		f64 total = 0.0;
+		for ( u32 run = 0; run < c_runs; ++run )
+		{
+			total += tests::Time( [ & ]
+			{
+				JobQueue& queue = pool.GetJobQueue();
+				queue.Reserve( c_jobCount );
+
+				for ( u32 job = 0; job < c_jobCount; ++job )
+					queue.AddJob< TinyJob >( job, order[ job ] );
+
+				if ( with_dependencies )
+					for ( u32 job = 0; job < c_jobCount; ++job )
+						for ( u32 dependency : dependencies[ job ] )
+							queue.GetJob( job )->AddDependency( queue.GetJob( dependency ) );
+
+				pool.Begin();
+				pool.Wait();
+			} );
+
+			for ( u32 job = 0; job < c_jobCount; ++job )
+			{
+				CHECK( order[ job ] );
+
+				if ( with_dependencies )
+					for ( u32 dependency : dependencies[ job ] )
+						CHECK( order[ dependency ] < order[ job ] );
+			}
+
+			std::fill( order.begin(), order.end(), 0 );
+		}
+
+		std::printf( "%-24s %8.3fms\n", with_dependencies ? "random dependencies" : "independent jobs", total / c_runs );
+	}
+
+	// small frames with gaps between them, to see how much the workers cost while they've nothing to do
+	pool.ResetStats();
+	for ( u32 frame = 0; frame < c_runs; ++frame )
+	{
+		JobQueue& queue = pool.GetJobQueue();
+		for ( u32 job = 0; job < 64; ++job )
+			queue.AddJob< TinyJob >( job, order[ job ] );
+
+		pool.Begin();
+		pool.Wait();
+
+		std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+	}
+
+	const WorkerPool::Stats stats = pool.GetStats();
+	std::printf( "idle frames: utilisation %.3f, cpu %.3f, %llu wake ups, %.0fns average wake latency\n",
+		stats.GetUtilisation(), stats.GetCPUUtilisation(), (unsigned long long)stats.wakeUps, stats.GetAverageWakeLatency() );
+}
@@ -0,0 +1,103 @@
+#include "Tests/TestUtils.h"
+
+#include "Onyx/ParallelAlgorithms.h"
+
+#include <numeric>
+#include <random>
+#include <version>
+
+// std::execution::par is only compared against where the standard library has it and CMake found what it runs on
+#if defined( ONYX_BENCHMARK_STD_PAR ) && defined( __cpp_lib_execution )
+#include <execution>
+#define STD_PAR_TIME( ... ) tests::TimeBest( [ & ] { __VA_ARGS__; } )
+#else
+#define STD_PAR_TIME( ... ) -1.0
+#endif
+
+using namespace onyx;
+
+namespace
+{
+
+constexpr u32 c_count = 8'000'000;
+constexpr u32 c_sortCount = 2'000'000;
+
+void PrintRow( const char* name, f64 serial_time, f64 std_par_time, f64 parallel_time )
+{
+	std::printf( "%-12s %8.2fms ", name, serial_time );
+
+	if ( std_par_time < 0.0 )
+		std::printf( "%10s ", "n/a" );
+	else
+		std::printf( "%8.2fms ", std_par_time );
+
+	std::printf( "%8.2fms\n", parallel_time );
+}
+
+}
+
+// each algorithm against its serial and std::execution::par equivalents, with the results checked against the serial ones
+int main()
+{
+	std::printf( "%u hardware threads, %u workers\n", std::thread::hardware_concurrency(), LowLevel::GetWorkerPool().GetWorkerCount() );
+	std::printf( "%-12s %10s %10s %10s\n", "", "serial", "std par", "onyx" );
+
+	{
+		std::vector< f32 > serial( c_count, 1.0f ), std_par( c_count, 1.0f ), parallel( c_count, 1.0f );
+		const auto op = []( f32& value ) { value = value * 1.0001f + 0.5f; };
+
+		const f64 serial_time = tests::TimeBest( [ & ] { std::for_each( serial.begin(), serial.end(), op ); } );
+		const f64 std_par_time = STD_PAR_TIME( std::for_each( std::execution::par, std_par.begin(), std_par.end(), op ) );
+		const f64 parallel_time = tests::TimeBest( [ & ] { ParallelFor( 0, c_count, [ & ]( u32 index ) { op( parallel[ index ] ); } ); } );
+
+		CHECK( serial == parallel );
+		CHECK( std_par_time < 0.0 || serial == std_par );
+		PrintRow( "for 8M", serial_time, std_par_time, parallel_time );
+	}
+
+	std::vector< u64 > input( c_count );
+	std::iota( input.begin(), input.end(), 0 );
+	const auto add = []( u64 lhs, u64 rhs ) { return lhs + rhs; };
+
+	{
+		// volatile, so the serial reduce isn't hoisted out of the timing loop
+		volatile u64 serial = 0, std_par = 0, parallel = 0;
+
+		const f64 serial_time = tests::TimeBest( [ & ] { serial = std::reduce( input.begin(), input.end(), u64( 0 ) ); } );
+		const f64 std_par_time = STD_PAR_TIME( std_par = std::reduce( std::execution::par, input.begin(), input.end(), u64( 0 ) ) );
+		const f64 parallel_time = tests::TimeBest( [ & ] { parallel = ParallelReduce( 0u, c_count, u64( 0 ), [ & ]( u32 index ) { return input[ index ]; }, add, 16384 ); } );
+
+		CHECK( serial == parallel );
+		CHECK( std_par_time < 0.0 || serial == std_par );
+		PrintRow( "reduce 8M", serial_time, std_par_time, parallel_time );
+	}
+
+	{
+		std::vector< u64 > serial( c_count ), std_par( c_count ), parallel( c_count );
+
+		const f64 serial_time = tests::TimeBest( [ & ] { std::inclusive_scan( input.begin(), input.end(), serial.begin() ); } );
+		const f64 std_par_time = STD_PAR_TIME( std::inclusive_scan( std::execution::par, input.begin(), input.end(), std_par.begin() ) );
+		const f64 parallel_time = tests::TimeBest( [ & ] { ParallelInclusiveScan< u64 >( input, parallel, 0, add, 16384 ); } );
+
+		CHECK( serial == parallel );
+		CHECK( std_par_time < 0.0 || serial == std_par );
+		PrintRow( "scan 8M", serial_time, std_par_time, parallel_time );
+	}
+
+	{
+		std::mt19937 rng( 1 );
+		std::vector< u32 > unsorted( c_sortCount );
+		for ( u32& value : unsorted )
+			value = rng();
+
+		std::vector< u32 > serial, std_par, parallel;
+
+		const f64 serial_time = tests::TimeBest( [ & ] { serial = unsorted; std::sort( serial.begin(), serial.end() ); } );
+		const f64 std_par_time = STD_PAR_TIME( std_par = unsorted; std::sort( std::execution::par, std_par.begin(), std_par.end() ) );
+		const f64 parallel_time = tests::TimeBest( [ & ] { parallel = unsorted; ParallelSort( parallel.begin(), parallel.end() ); } );
+
+		CHECK( serial == parallel );
+		CHECK( std_par_time < 0.0 || serial == std_par );
+		PrintRow( "sort 2M", serial_time, std_par_time, parallel_time );
+	}
+}
@@ -0,0 +1,95 @@
+#include "Tests/TestUtils.h"
+
+#include "Onyx/ECS/World.h"
+#include "Onyx/ECS/Modules/Core.h"
+
+using namespace onyx;
+using namespace onyx::ecs;
+using Core::AttachedTo;
+using Core::Transform2D;
+
+namespace
+{
+
+// 1000 trees with 4 children per parent, 2 levels deep, so 21 transforms each, and 20k transforms on their own
+constexpr u32 c_treeCount = 1000;
+constexpr u32 c_treeDepth = 2;
+constexpr u32 c_childrenPerParent = 4;
+constexpr u32 c_unattachedCount = 20'000;
+
+}
+
+int main()
+{
+	World world;
+	QuerySet query_set( world );
+	auto transforms = query_set.Get< Core::UpdateTransform2DLocales::Transforms >();
+
+	std::vector< EntityID > roots;
+	for ( u32 tree = 0; tree < c_treeCount; ++tree )
+	{
+		roots.push_back( world.AddEntity( Transform2D() ) );
+
+		std::vector< EntityID > level { roots.back() };
+		for ( u32 depth = 0; depth < c_treeDepth; ++depth )
+		{
+			std::vector< EntityID > next_level;
+			for ( const EntityID parent : level )
+				for ( u32 child = 0; child < c_childrenPerParent; ++child )
+					next_level.push_back( world.AddEntity( Transform2D( glm::vec2( 1.f, 0.f ) ), AttachedTo{ parent } ) );
+
+			level = std::move( next_level );
+		}
+	}
+
+	std::vector< EntityID > unattached;
+	for ( u32 index = 0; index < c_unattachedCount; ++index )
+		unattached.push_back( world.AddEntity( Transform2D() ) );
+
+	// only the update is timed, not the query update or the clean up around it
+	const auto update = [ & ]
+	{
+		world.m_queryManager.UpdateNeedsRerun( world );
+		query_set.Update();
+
+		const World& const_world = world;
+		const f64 time = tests::Time( [ & ] { Core::UpdateTransform2DLocales::System( Core::UpdateTransform2DLocales::Context( const_world ), *transforms ); } );
+
+		world.CleanUpPages();
+		return time;
+	};
+
+	update();
+
+	const auto average = [ & ]( u32 frames, const auto& move )
+	{
+		f64 total = 0.0;
+		for ( u32 frame = 0; frame < frames; ++frame )
+		{
+			move( frame );
+			total += update();
+		}
+
+		return total / frames;
+	};
+
+	const f64 few_roots = average( 50, [ & ]( u32 frame ) {
+		for ( u32 index = 0; index < 10; ++index )
+			world.GetComponent< Transform2D >( roots[ ( frame * 10 + index ) % roots.size() ] )->SetLocalRotation( f32( frame ) );
+	} );
+
+	const f64 all_roots = average( 20, [ & ]( u32 frame ) {
+		for ( const EntityID root : roots )
+			world.GetComponent< Transform2D >( root )->SetLocalRotation( f32( frame ) );
+	} );
+
+	const f64 all_unattached = average( 20, [ & ]( u32 frame ) {
+		for ( const EntityID entity : unattached )
+			world.GetComponent< Transform2D >( entity )->SetLocalRotation( f32( frame ) );
+	} );
+
+	std::printf( "%u transforms, %u trees\n", transforms->Count(), c_treeCount );
+	std::printf( "10 roots moving          %8.3fms\n", few_roots );
+	std::printf( "every root moving        %8.3fms\n", all_roots );
+	std::printf( "unattached moving        %8.3fms\n", all_unattached );
+}
@@ -0,0 +1,131 @@
+#include "Tests/TestUtils.h"
+
+#include "Onyx/ECS/CommandBuffer.h"
+#include "Onyx/ECS/Modules/Core.h"
+
+#include <functional>
+
+using namespace onyx;
+using namespace onyx::ecs;
+
+namespace
+{
+
+struct Value { i32 value; };
+struct Other { i32 value; };
+
+// changes to the same component keep the order they were recorded in, whatever else is batched around them
+void TestComponentChangesKeepTheirOrder()
+{
+	World world;
+	CommandBuffer commands( world );
+
+	const EntityID entity = world.AddEntity( Value{ 0 } );
+
+	commands.AddComponent( entity, Value{ 1 } );
+	commands.AddComponent( entity, Other{ 1 } );
+	commands.RemoveComponent< Value >( entity );
+	commands.AddComponent( entity, Value{ 2 } );
+	commands.RemoveComponent< Other >( entity );
+
+	const EntityID added = commands.AddEntity( Value{ 3 } );
+	commands.AddComponent( added, Other{ 3 } );
+
+	commands.Execute();
+
+	CHECK( world.GetComponent< Value >( entity ) && world.GetComponent< Value >( entity )->value == 2 );
+	CHECK( !world.GetComponent< Other >( entity ) );
+	CHECK( world.GetComponent< Value >( added ) && world.GetComponent< Value >( added )->value == 3 );
+	CHECK( world.GetComponent< Other >( added ) && world.GetComponent< Other >( added )->value == 3 );
+}
+
+// a change recorded after a removal has to see the world after the removal, not be batched in ahead of it
+void TestNothingMovesPastARemoval()
+{
+	World world;
+	CommandBuffer commands( world );
+
+	const EntityID parent = world.AddEntity( Value{ 0 } );
+	const EntityID child = world.AddEntity( Value{ 1 }, Core::AttachedTo{ parent } );
+	const EntityID late_child = world.AddEntity( Value{ 2 } );
+
+	commands.RemoveEntity( parent, true );
+
+	// the parent is gone by the time this runs, so it doesn't attach, and isn't removed with the parent's children
+	commands.AddComponent( late_child, Core::AttachedTo{ parent } );
+	commands.AddComponent( late_child, Value{ 3 } );
+
+	commands.Execute();
+
+	CHECK( !world.IsAlive( parent ) );
+	CHECK( !world.IsAlive( child ) );
+	CHECK( world.IsAlive( late_child ) );
+	CHECK( world.GetComponent< Value >( late_child )->value == 3 );
+}
+
+// calls a function that can be swapped between runs
+struct RecordingJob : IJob
+{
+	void Run() override { m_record(); }
+
+	std::function< void() > m_record;
+};
+
+// commands from jobs and from outside of them come out in the order they were recorded in, across graphs and RunAndWaits
+// each entity gets two values recorded one after the other, so it ends up with the second one if they were kept in order
+void TestRunsKeepTheirOrder()
+{
+	WorkerPool& pool = onyx::LowLevel::GetWorkerPool();
+
+	World world;
+	CommandBuffer commands( world );
+
+	EntityID entities[ 6 ];
+	for ( EntityID& entity : entities )
+		entity = world.AddEntity( Value{ 0 } );
+
+	const auto set = [ & ]( u32 entity, i32 value ) { commands.AddComponent( entities[ entity ], Value{ value } ); };
+
+	JobGraph graph;
+	RecordingJob& first_job = graph.AddJob< RecordingJob >();
+	RecordingJob& second_job = graph.AddJob< RecordingJob >();
+
+	set( 0, 1 );
+
+	first_job.m_record = [ & ] { set( 0, 2 ); set( 1, 1 ); set( 3, 1 ); };
+	second_job.m_record = [ & ] { set( 5, 1 ); };
+	pool.Begin( graph );
+	pool.Wait();
+
+	set( 1, 2 );
+	set( 2, 1 );
+
+	RecordingJob fork;
+	fork.m_record = [ & ] { set( 2, 2 ); set( 3, 2 ); set( 4, 1 ); };
+	IJob* const fork_ptrs[] = { &fork };
+	pool.RunAndWait( fork_ptrs );
+
+	set( 4, 2 );
+
+	// the same graph again, with a job that came first in the graph recording after a later one did last time
+	first_job.m_record = [ & ] { set( 5, 2 ); };
+	second_job.m_record = [] {};
+	pool.Begin( graph );
+	pool.Wait();
+
+	commands.Execute();
+
+	for ( const EntityID entity : entities )
+		CHECK( world.GetComponent< Value >( entity )->value == 2 );
+}
+
+}
+
+int main()
+{
+	TestComponentChangesKeepTheirOrder();
+	TestNothingMovesPastARemoval();
+	TestRunsKeepTheirOrder();
+
+	std::printf( "CommandBuffer tests passed\n" );
+}
@@ -0,0 +1,13 @@
+#include "TestUtils.h"
+
+namespace onyx::LowLevel
+{
+
+// the tests don't start the low level interface, so they get a pool of their own with a worker per hardware thread
+WorkerPool& GetWorkerPool()
+{
+	static WorkerPool s_workerPool;
+	return s_workerPool;
+}
+
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "Onyx/Multithreading.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+// unlike the asserts, checks are made in every configuration, and end the test with a failure straight away
+#define CHECK( condition ) do { if ( !( condition ) ) { std::printf( "%s(%d): check failed: %s\n", __FILE__, __LINE__, #condition ); std::exit( 1 ); } } while ( false )
+
+namespace onyx::tests
+{
+
+// how long one run of func takes, in milliseconds
+template< typename Func >
+f64 Time( const Func& func )
+{
+	const auto start = std::chrono::steady_clock::now();
+	func();
+	return std::chrono::duration< f64, std::milli >( std::chrono::steady_clock::now() - start ).count();
+}
+
+// the quickest of a few runs of func, in milliseconds, after one to warm up
+template< typename Func >
+f64 TimeBest( const Func& func, u32 runs = 7 )
+{
+	func();
+
+	f64 best = Time( func );
+	for ( u32 run = 1; run < runs; ++run )
+		best = std::min( best, Time( func ) );
+
+	return best;
+}
+
+}
@@ -0,0 +1,94 @@
+#include "Tests/TestUtils.h"
+
+#include "Onyx/ECS/World.h"
+#include "Onyx/ECS/Modules/Core.h"
+
+using namespace onyx;
+using namespace onyx::ecs;
+using Core::AttachedTo;
+using Core::Transform2D;
+
+namespace
+{
+
+struct TransformWorld
+{
+	World world;
+	QuerySet querySet { world };
+	std::shared_ptr< Core::UpdateTransform2DLocales::Transforms > transforms = querySet.Get< Core::UpdateTransform2DLocales::Transforms >();
+
+	// one frame's worth of UpdateTransform2DLocales
+	void Update()
+	{
+		world.m_queryManager.UpdateNeedsRerun( world );
+		querySet.Update();
+
+		const World& const_world = world;
+		Core::UpdateTransform2DLocales::System( Core::UpdateTransform2DLocales::Context( const_world ), *transforms );
+
+		world.CleanUpPages();
+	}
+
+	Transform2D& Get( EntityID entity ) { return *world.GetComponent< Transform2D >( entity ); }
+};
+
+// a whole tree settles in one frame, and everything the update visits is left unmoved
+void TestMovesReachTheWholeTree()
+{
+	TransformWorld transforms;
+	World& world = transforms.world;
+
+	const EntityID root = world.AddEntity( Transform2D( glm::vec2( 1.f, 2.f ) ) );
+	const EntityID child = world.AddEntity( Transform2D( glm::vec2( 3.f, 0.f ), glm::vec2( 2.f, 2.f ) ), AttachedTo{ root } );
+	const EntityID grandchild = world.AddEntity( Transform2D( glm::vec2( 0.f, 1.f ) ), AttachedTo{ child } );
+
+	transforms.Update();
+
+	CHECK( transforms.Get( child ).GetLocaleAffine() == transforms.Get( root ).GetAffine() );
+	CHECK( transforms.Get( grandchild ).GetLocaleAffine() == transforms.Get( child ).GetAffine() );
+
+	transforms.Get( root ).SetLocalRotation( 90.f );
+	transforms.Update();
+
+	CHECK( transforms.Get( child ).GetLocaleAffine() == transforms.Get( root ).GetAffine() );
+	CHECK( transforms.Get( grandchild ).GetLocaleAffine() == transforms.Get( child ).GetAffine() );
+
+	for ( const EntityID entity : { root, child, grandchild } )
+		CHECK( !transforms.Get( entity ).HasMoved() );
+}
+
+// leaves' flags aren't read, but a leaf that gains a child passes its matrix on and is cleared like any other parent
+void TestLeavesAreClearedOnceTheyHaveChildren()
+{
+	TransformWorld transforms;
+	World& world = transforms.world;
+
+	const EntityID leaf = world.AddEntity( Transform2D() );
+	transforms.Update();
+
+	transforms.Get( leaf ).SetLocalPosition( glm::vec2( 5.f, 5.f ) );
+	transforms.Update();
+
+	const EntityID child = world.AddEntity( Transform2D( glm::vec2( 1.f, 0.f ) ), AttachedTo{ leaf } );
+	transforms.Update();
+
+	CHECK( transforms.Get( child ).GetLocaleAffine() == transforms.Get( leaf ).GetAffine() );
+	CHECK( !transforms.Get( leaf ).HasMoved() );
+	CHECK( !transforms.Get( child ).HasMoved() );
+
+	// and it stays that way until it moves again
+	const Core::Affine2D locale = transforms.Get( child ).GetLocaleAffine();
+	transforms.Update();
+	CHECK( transforms.Get( child ).GetLocaleAffine() == locale );
+	CHECK( !transforms.Get( leaf ).HasMoved() );
+}
+
+}
+
+int main()
+{
+	TestMovesReachTheWholeTree();
+	TestLeavesAreClearedOnceTheyHaveChildren();
+
+	std::printf( "Transform tests passed\n" );
+}
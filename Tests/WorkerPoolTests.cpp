@@ -0,0 +1,217 @@
+#include "Tests/TestUtils.h"
+
+#include <mutex>
+#include <thread>
+
+using namespace onyx;
+
+namespace
+{
+
+struct CountingJob : IJob
+{
+	CountingJob( std::atomic_uint32_t& counter ) : m_counter( counter ) {}
+	void Run() override { m_counter.fetch_add( 1, std::memory_order_relaxed ); }
+
+	std::atomic_uint32_t& m_counter;
+};
+
+// runs until it's told to stop, so it's still running when the frame that started it is waited on
+struct BlockingJob : IJob
+{
+	BlockingJob( std::atomic_bool& started, std::atomic_bool& release ) : m_started( started ), m_release( release ) {}
+
+	void Run() override
+	{
+		m_started = true;
+		while ( !m_release )
+			std::this_thread::yield();
+	}
+
+	std::atomic_bool& m_started;
+	std::atomic_bool& m_release;
+};
+
+// forks a few jobs of its own until it's deep enough, noting down each job's key and where it is in the tree
+struct ForkingJob : IJob
+{
+	struct Record
+	{
+		u64 orderKey;
+		std::vector< u32 > path;
+	};
+
+	ForkingJob( WorkerPool& pool, std::vector< u32 > path, std::mutex& mutex, std::vector< Record >& records )
+		: m_pool( pool ), m_path( std::move( path ) ), m_mutex( mutex ), m_records( records ) {}
+
+	void Run() override
+	{
+		{
+			std::lock_guard lock( m_mutex );
+			m_records.push_back( { orderKey, m_path } );
+		}
+
+		if ( m_path.size() == 4 )
+			return;
+
+		// a wide fork at the top, so the fields aren't all the same size
+		const u32 fork_count = m_path.size() == 1 ? 37 : 3;
+
+		std::vector< std::unique_ptr< ForkingJob > > forks;
+		std::vector< IJob* > fork_ptrs;
+		for ( u32 fork = 0; fork < fork_count; ++fork )
+		{
+			std::vector< u32 > fork_path = m_path;
+			fork_path.push_back( fork );
+
+			forks.push_back( std::make_unique< ForkingJob >( m_pool, std::move( fork_path ), m_mutex, m_records ) );
+			fork_ptrs.push_back( forks.back().get() );
+		}
+
+		m_pool.RunAndWait( fork_ptrs );
+	}
+
+	WorkerPool& m_pool;
+	std::vector< u32 > m_path;
+	std::mutex& m_mutex;
+	std::vector< Record >& m_records;
+};
+
+// sorting by order key has to put nested forks in the same order as the tree they were forked in, every time
+void TestNestedForkOrderKeys( WorkerPool& pool )
+{
+	std::mutex mutex;
+	std::vector< ForkingJob::Record > records;
+
+	JobGraph graph;
+	for ( u32 job = 0; job < 3; ++job )
+		graph.AddJob< ForkingJob >( pool, std::vector< u32 > { job }, mutex, records );
+
+	std::vector< u64 > first_keys;
+	for ( u32 frame = 0; frame < 3; ++frame )
+	{
+		records.clear();
+		pool.Begin( graph );
+		pool.Wait();
+
+		std::sort( records.begin(), records.end(), []( const auto& lhs, const auto& rhs ) { return IJob::IsOrderedBefore( lhs.orderKey, rhs.orderKey ); } );
+
+		// a job's path is a prefix of its forks' paths, so it comes before them, and siblings come in the order they were forked
+		for ( size_t index = 1; index < records.size(); ++index )
+		{
+			CHECK( IJob::IsOrderedBefore( records[ index - 1 ].orderKey, records[ index ].orderKey ) );
+			CHECK( records[ index - 1 ].path < records[ index ].path );
+		}
+
+		// each run of the graph is a new run, but below that the keys are the same every time
+		std::vector< u64 > keys;
+		for ( const auto& record : records )
+			keys.push_back( record.orderKey & ( ( u64( 1 ) << IJob::c_orderKeyRunShift ) - 1 ) );
+
+		if ( frame == 0 )
+			first_keys = keys;
+
+		CHECK( keys == first_keys );
+	}
+
+	CHECK( records.size() == 3 * ( 1 + 37 + 37 * 3 + 37 * 9 ) );
+}
+
+// a task that forks jobs over and over mustn't change how many frame jobs Wait is waiting for
+void TestForksDuringFrames( WorkerPool& pool )
+{
+	std::atomic_bool stop = false;
+	std::atomic_uint32_t forked_jobs_run = 0;
+
+	auto task = pool.Submit( TaskPriority::Normal, [ & ]
+	{
+		u32 rounds = 0;
+		while ( !stop )
+		{
+			CountingJob jobs[ 3 ] = { forked_jobs_run, forked_jobs_run, forked_jobs_run };
+			IJob* const job_ptrs[ 3 ] = { &jobs[ 0 ], &jobs[ 1 ], &jobs[ 2 ] };
+			pool.RunAndWait( job_ptrs );
+			++rounds;
+		}
+
+		return rounds;
+	} );
+
+	std::atomic_uint32_t frame_jobs_run = 0;
+	JobGraph graph;
+	for ( u32 job = 0; job < 8; ++job )
+		graph.AddJob< CountingJob >( frame_jobs_run );
+
+	constexpr u32 c_frameCount = 20'000;
+	for ( u32 frame = 0; frame < c_frameCount; ++frame )
+	{
+		pool.Begin( graph );
+		pool.Wait();
+		CHECK( !pool.IsFrameInFlight() );
+	}
+
+	stop = true;
+	const u32 rounds = task.get();
+
+	CHECK( frame_jobs_run == c_frameCount * graph.Count() );
+	CHECK( forked_jobs_run == rounds * 3 );
+}
+
+// Wait returns once the frame's jobs are done, even if a task's jobs are still running
+void TestWaitIgnoresForks( WorkerPool& pool )
+{
+	std::atomic_bool started = false;
+	std::atomic_bool release = false;
+
+	auto task = pool.Submit( TaskPriority::Normal, [ & ]
+	{
+		BlockingJob job( started, release );
+		IJob* const job_ptr = &job;
+		pool.RunAndWait( { &job_ptr, 1 } );
+	} );
+
+	while ( !started )
+		std::this_thread::yield();
+
+	CHECK( !pool.IsFrameInFlight() );
+
+	std::atomic_uint32_t frame_jobs_run = 0;
+	JobGraph graph;
+	graph.AddJob< CountingJob >( frame_jobs_run );
+
+	pool.Begin( graph );
+	pool.Wait();
+
+	CHECK( frame_jobs_run == 1 );
+	CHECK( !pool.IsFrameInFlight() );
+
+	release = true;
+	task.get();
+}
+
+// background tasks never take the last worker, so with fewer than two they run as they're submitted
+void TestBackgroundTasksLeaveAWorker( WorkerPool& pool )
+{
+	auto task = pool.Submit( TaskPriority::Background, [] { return 1; } );
+
+	if ( pool.GetWorkerCount() < 2 )
+		CHECK( task.wait_for( std::chrono::seconds( 0 ) ) == std::future_status::ready );
+
+	CHECK( task.get() == 1 );
+}
+
+}
+
+int main()
+{
+	// the tasks in these tests need a worker to run on while the main thread runs the frames
+	WorkerPool pool( 4 );
+	CHECK( pool.GetWorkerCount() > 0 );
+
+	TestForksDuringFrames( pool );
+	TestWaitIgnoresForks( pool );
+	TestBackgroundTasksLeaveAWorker( pool );
+	TestNestedForkOrderKeys( pool );
+
+	std::printf( "WorkerPool tests passed with %u workers\n", pool.GetWorkerCount() );
+}
@@ -0,0 +1,88 @@
+#include "Tests/TestUtils.h"
+
+#include "Onyx/ECS/World.h"
+#include "Onyx/ECS/Modules/Core.h"
+
+using namespace onyx;
+using namespace onyx::ecs;
+
+namespace
+{
+
+struct Value { i32 value; };
+
+// copied attachments point at ids in the world they came from, which can belong to unrelated entities in the one they're copied to
+// so they mustn't be linked until they've been mapped, which is what the AttachedTo reflector's PostCopy does
+void TestCopiedAttachmentsWaitForMapping()
+{
+	World source;
+	const EntityID source_parent = source.AddEntity( Value{ 0 } );
+	source.AddEntity( Value{ 1 }, Core::AttachedTo{ source_parent } );
+
+	World world;
+	const EntityID unrelated = world.AddEntity( Value{ 2 } );
+	world.AddEntity( Value{ 3 } );
+	CHECK( unrelated == source_parent );
+
+	std::vector< std::pair< EntityID, EntityID > > id_map;
+	for ( auto iter = source.Iter(); iter; ++iter )
+		id_map.push_back( { iter.GetEntityID(), iter.CopyToWorld( world ) } );
+
+	const EntityID parent = id_map[ 0 ].second;
+	const EntityID child = id_map[ 1 ].second;
+
+	CHECK( world.GetParent( child ) == NoEntity );
+
+	bool unrelated_has_children = false;
+	world.ForEachChild( unrelated, [ & ]( EntityID ) { unrelated_has_children = true; } );
+	CHECK( !unrelated_has_children );
+
+	world.AddComponent( child, Core::AttachedTo{ parent } );
+	CHECK( world.GetParent( child ) == parent );
+}
+
+// the hierarchy keeps a list of the entities with children, so systems can find them without looking at every entity
+void TestHierarchyTracksParents()
+{
+	World world;
+
+	const EntityID root = world.AddEntity( Value{ 0 } );
+	const EntityID middle = world.AddEntity( Value{ 1 }, Core::AttachedTo{ root } );
+	const EntityID leaf = world.AddEntity( Value{ 2 }, Core::AttachedTo{ middle } );
+	const EntityID other_leaf = world.AddEntity( Value{ 3 }, Core::AttachedTo{ middle } );
+
+	const auto get_parents = [ & ]
+	{
+		std::vector< u32 > parents = world.GetHierarchy().GetParents();
+		std::sort( parents.begin(), parents.end() );
+		return parents;
+	};
+
+	CHECK( get_parents() == ( std::vector< u32 > { root.GetIndex(), middle.GetIndex() } ) );
+
+	world.RemoveComponent< Core::AttachedTo >( leaf );
+	CHECK( get_parents() == ( std::vector< u32 > { root.GetIndex(), middle.GetIndex() } ) );
+
+	world.AddComponent( other_leaf, Core::AttachedTo{ root } );
+	CHECK( get_parents() == ( std::vector< u32 > { root.GetIndex() } ) );
+
+	world.AddComponent( leaf, Core::AttachedTo{ other_leaf } );
+	CHECK( get_parents() == ( std::vector< u32 > { root.GetIndex(), other_leaf.GetIndex() } ) );
+
+	world.RemoveEntity( root );
+	CHECK( get_parents() == ( std::vector< u32 > { other_leaf.GetIndex() } ) );
+
+	world.RemoveEntity( other_leaf, true );
+	CHECK( get_parents().empty() );
+	CHECK( world.IsAlive( middle ) && !world.IsAlive( leaf ) );
+}
+
+}
+
+int main()
+{
+	TestCopiedAttachmentsWaitForMapping();
+	TestHierarchyTracksParents();
+
+	std::printf( "World tests passed\n" );
+}